@@ -0,0 +1,102 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QImage>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QtTest>
+
+#include "iconcache.h"
+
+/**
+ * Measures the monochrome analysis of IconCache, which runs for every icon
+ * that isn't in the cache yet, and the lookup of a guess made before.
+ */
+class IconCacheBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void benchmarkIsMonochrome_data();
+    void benchmarkIsMonochrome();
+    void benchmarkGuessMonochromeHit_data();
+    void benchmarkGuessMonochromeHit();
+
+private:
+    void addImageRows();
+};
+
+// A dark glyph on a transparent background, as in symbolic icons
+static QImage monochromeImage(int size)
+{
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(35, 38, 39));
+    painter.drawEllipse(QRectF(size * 0.1, size * 0.1, size * 0.8, size * 0.8));
+    return image;
+}
+
+// A colorful, fully opaque image, as in application icons and photos
+static QImage colorfulImage(int size)
+{
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size, size);
+    gradient.setColorAt(0.0, Qt::red);
+    gradient.setColorAt(0.5, Qt::green);
+    gradient.setColorAt(1.0, Qt::blue);
+    painter.fillRect(image.rect(), gradient);
+    return image;
+}
+
+void IconCacheBenchmark::addImageRows()
+{
+    QTest::addColumn<QImage>("image");
+
+    for (int size : {16, 22, 32, 48, 64, 128, 256}) {
+        QTest::newRow(qPrintable(QStringLiteral("monochrome %1").arg(size))) << monochromeImage(size);
+        QTest::newRow(qPrintable(QStringLiteral("colorful %1").arg(size))) << colorfulImage(size);
+    }
+}
+
+void IconCacheBenchmark::benchmarkIsMonochrome_data()
+{
+    addImageRows();
+}
+
+void IconCacheBenchmark::benchmarkIsMonochrome()
+{
+    QFETCH(QImage, image);
+
+    bool monochrome = false;
+    QBENCHMARK {
+        monochrome = IconCache::isMonochrome(image);
+    }
+    QCOMPARE(monochrome, QByteArray(QTest::currentDataTag()).startsWith("monochrome"));
+}
+
+void IconCacheBenchmark::benchmarkGuessMonochromeHit_data()
+{
+    addImageRows();
+}
+
+void IconCacheBenchmark::benchmarkGuessMonochromeHit()
+{
+    QFETCH(QImage, image);
+
+    const QString source = QString::fromLatin1(QTest::currentDataTag());
+    const bool monochrome = IconCache::instance()->guessMonochrome(image, source);
+    QBENCHMARK {
+        QCOMPARE(IconCache::instance()->guessMonochrome(image, source), monochrome);
+    }
+}
+
+QTEST_MAIN(IconCacheBenchmark)
+
+#include "iconcachebenchmark.moc"
@@ -9,4 +9,7 @@ import org.kde.kirigami 2.11 as Kirigami
 
 Kirigami.Page {
     title: qsTr("INITIAL TITLE")
+    property color color: "transparent"
+    property int poolCost: 1
+    Kirigami.PagePool.cost: poolCost
 }
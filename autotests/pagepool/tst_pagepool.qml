@@ -7,7 +7,7 @@
 import QtQuick 2.7
 import QtQuick.Controls 2.0
 import QtQuick.Window 2.1
-import org.kde.kirigami 2.11 as Kirigami
+import org.kde.kirigami 2.15 as Kirigami
 import QtTest 1.0
 
 TestCase {
@@ -34,6 +34,7 @@ TestCase {
 
     Kirigami.PagePool {
         id: pool
+        objectName: "main"
     }
 
     function init() {
@@ -112,4 +113,177 @@ TestCase {
         loadPageActionPropDoesNotExist.trigger()
         verify(pool.lastLoadedUrl.toString().endsWith(expectedUrl))
     }
+
+    Kirigami.PagePool {
+        id: boundedPool
+        maximumCachedPages: 2
+    }
+
+    SignalSpy {
+        id: evictedSpy
+        target: boundedPool
+        signalName: "evicted"
+    }
+
+    function test_maximumCachedPages () {
+        boundedPool.clear()
+        evictedSpy.clear()
+
+        var shown = boundedPool.loadPage("TestPage.qml?bounded=shown")
+        mainWindow.pageStack.push(shown)
+        boundedPool.loadPage("TestPage.qml?bounded=a")
+        boundedPool.loadPage("TestPage.qml?bounded=b")
+        compare(boundedPool.cachedCount, 2)
+        compare(evictedSpy.count, 1)
+        verify(evictedSpy.signalArguments[0][0].toString().endsWith("TestPage.qml?bounded=a"))
+
+        // The page in the PageRow must never be evicted
+        verify(boundedPool.contains("TestPage.qml?bounded=shown"))
+        verify(!boundedPool.contains("TestPage.qml?bounded=a"))
+        verify(boundedPool.contains("TestPage.qml?bounded=b"))
+
+        boundedPool.loadPage("TestPage.qml?bounded=b")
+        var stats = boundedPool.cacheStatistics()
+        compare(stats.hits, 1)
+        compare(stats.evictions, 1)
+        compare(stats.cost, 2)
+    }
+
+    // The cached cost follows pages changing their cost
+    function test_costChanged () {
+        var page = pool.loadPage("TestPage.qml?cost=changed")
+        pool.loadPage("TestPage.qml?cost=other")
+        compare(pool.cachedCost, 2)
+
+        page.poolCost = 3
+        compare(pool.cachedCost, 4)
+
+        pool.deletePage(page)
+        compare(pool.cachedCost, 1)
+        compare(pool.cachedCount, 1)
+    }
+
+    SignalSpy {
+        id: prefetchedSpy
+        target: pool
+        signalName: "prefetched"
+    }
+
+    function test_prefetch () {
+        prefetchedSpy.clear()
+        pool.prefetch(["TestPage.qml?prefetch=page"], 0, true)
+        tryCompare(prefetchedSpy, "count", 1)
+        verify(pool.contains("TestPage.qml?prefetch=page"))
+
+        var prefetched = pool.pageForUrl("TestPage.qml?prefetch=page")
+        compare(pool.loadPage("TestPage.qml?prefetch=page"), prefetched)
+    }
+
+    function test_prefetchCancelledByClear () {
+        prefetchedSpy.clear()
+        pool.prefetch(["TestPage.qml?prefetch=a", "TestPage.qml?prefetch=b"], 0, true)
+        pool.clear()
+        wait(50)
+        compare(prefetchedSpy.count, 0)
+        verify(!pool.contains("TestPage.qml?prefetch=a"))
+        verify(!pool.contains("TestPage.qml?prefetch=b"))
+    }
+
+    Kirigami.PagePoolAction {
+        id: asynchronousAction
+        pagePool: pool
+        pageStack: mainWindow.pageStack
+        page: "TestPage.qml?action=asynchronousAction"
+        asynchronous: true
+        initialProperties: {
+            return {title: "ASYNC TITLE" }
+        }
+    }
+
+    function test_loadPageAsynchronously () {
+        var expectedUrl = "TestPage.qml?action=asynchronousAction"
+        compare(mainWindow.pageStack.depth, 0)
+        asynchronousAction.trigger()
+        tryCompare(mainWindow.pageStack, "depth", 1)
+        verify(pool.lastLoadedUrl.toString().endsWith(expectedUrl))
+        compare(mainWindow.pageStack.currentItem.title, "ASYNC TITLE")
+    }
+
+    function test_cancelLoad () {
+        var called = false
+        var handle = pool.loadPageAsynchronously("TestPage.qml?cancel=1", {}, function(page) {
+            called = true
+        })
+        verify(handle > 0)
+        pool.cancelLoad(handle)
+        wait(50)
+        verify(!called)
+        verify(!pool.contains("TestPage.qml?cancel=1"))
+    }
+
+    Kirigami.PagePool {
+        id: keyedPool
+        cacheKeyProperties: ["title"]
+        maximumPagesPerUrl: 2
+    }
+
+    function test_cacheKeyProperties () {
+        keyedPool.clear()
+        var red = keyedPool.loadPageWithProperties("TestPage.qml?keyed", {title: "RED"})
+        var blue = keyedPool.loadPageWithProperties("TestPage.qml?keyed", {title: "BLUE"})
+        verify(red !== blue)
+        compare(red.title, "RED")
+        compare(blue.title, "BLUE")
+        compare(keyedPool.loadPageWithProperties("TestPage.qml?keyed", {title: "RED"}), red)
+
+        // Only two instances per url are kept
+        var green = keyedPool.loadPageWithProperties("TestPage.qml?keyed", {title: "GREEN"})
+        compare(keyedPool.cachedCount, 2)
+        compare(keyedPool.loadPageWithProperties("TestPage.qml?keyed", {title: "RED"}), red)
+        compare(keyedPool.urlForPage(green).toString(), keyedPool.resolvedUrl("TestPage.qml?keyed").toString())
+    }
+
+    Kirigami.PagePool {
+        id: colorPool
+        cacheKeyProperties: ["color"]
+    }
+
+    // Keys keep what JSON would lose, such as the alpha of colors
+    function test_cacheKeyPropertiesLossless () {
+        colorPool.clear()
+        var opaque = colorPool.loadPageWithProperties("TestPage.qml?color", {color: Qt.rgba(1, 0, 0, 1)})
+        var translucent = colorPool.loadPageWithProperties("TestPage.qml?color", {color: Qt.rgba(1, 0, 0, 0.5)})
+        verify(opaque !== translucent)
+        compare(opaque.color.a, 1)
+        fuzzyCompare(translucent.color.a, 0.5, 0.01)
+        compare(colorPool.loadPageWithProperties("TestPage.qml?color", {color: Qt.rgba(1, 0, 0, 0.5)}), translucent)
+        compare(colorPool.loadPageWithProperties("TestPage.qml?color", {color: Qt.rgba(1, 0, 0, 1)}), opaque)
+    }
+
+    function test_loadPageWithKey () {
+        var first = pool.loadPageWithKey("TestPage.qml?withKey", "first")
+        var second = pool.loadPageWithKey("TestPage.qml?withKey", "second", {title: "SECOND"})
+        verify(first !== second)
+        compare(pool.loadPageWithKey("TestPage.qml?withKey", "first"), first)
+        pool.deletePage("TestPage.qml?withKey")
+        verify(!pool.contains("TestPage.qml?withKey"))
+    }
+
+    function test_cacheManagerTrim () {
+        pool.loadPage("TestPage.qml?trim=a")
+        pool.loadPage("TestPage.qml?trim=b")
+        var shown = pool.loadPage("TestPage.qml?trim=shown")
+        mainWindow.pageStack.push(shown)
+        // Costs are estimated sizes in bytes, whatever the unit of maximumCachedPages
+        var entry = Kirigami.CacheManager.statistics().filter(function(cache) { return cache.name === "PagePool main" })[0]
+        verify(entry)
+        verify(entry.cost > pool.cachedCount * 1024)
+        compare(entry.cost, pool.cacheStatistics().size)
+        verify(Kirigami.CacheManager.totalCost >= entry.cost)
+
+        Kirigami.CacheManager.trim(Kirigami.CacheManager.Critical)
+        // Pages in use are never trimmed
+        compare(pool.cachedCount, 1)
+        verify(pool.contains("TestPage.qml?trim=shown"))
+    }
 }
@@ -5,8 +5,9 @@
  */
 
 import QtQuick 2.12
+import QtQuick.Window 2.12
 import QtTest 1.0
-import org.kde.kirigami 2.11 as Kirigami
+import org.kde.kirigami 2.15 as Kirigami
 
 TestCase {
     id: testCase
@@ -23,6 +24,10 @@ TestCase {
     Component { id: sizeOnlyIcon; Kirigami.Icon { width: 50; height: 50 } }
     Component { id: sizeSourceIcon; Kirigami.Icon { width: 50; height: 50; source: "document-new" } }
     Component { id: minimalSizeIcon; Kirigami.Icon { width: 1; height: 1; source: "document-new" } }
+    Component { id: fileIcon; Kirigami.Icon { width: 32; height: 32; source: Qt.resolvedUrl("../logo.png") } }
+    Component { id: dataIcon; Kirigami.Icon { width: 32; height: 32; source: "data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAAAgAAAAICAYAAADED76LAAAAEklEQVR42mM4oaHxHx9mGBkKAOdkhcGWgnvEAAAAAElFTkSuQmCC" } }
+    Component { id: unreachableIcon; Kirigami.Icon { width: 32; height: 32; source: "http://127.0.0.1:1/avatar.png" } }
+    Component { id: asynchronousIcon; Kirigami.Icon { width: 48; height: 48; asynchronous: true; source: Qt.resolvedUrl("../logo.png") } }
 
     function test_create_data() {
         return [
@@ -42,4 +47,88 @@ TestCase {
         verify(icon)
         verify(waitForRendering(icon))
     }
+
+    // Identical icons are rasterized once and share their image
+    function test_sharedCache() {
+        var first = createTemporaryObject(fileIcon, testCase)
+        verify(waitForRendering(first))
+        compare(first.status, Kirigami.Icon.Ready)
+
+        var hits = Kirigami.IconCache.statistics().hits
+        var second = createTemporaryObject(fileIcon, testCase)
+        verify(waitForRendering(second))
+        compare(second.status, Kirigami.Icon.Ready)
+        verify(Kirigami.IconCache.statistics().hits > hits)
+    }
+
+    function test_asynchronous() {
+        Kirigami.IconCache.clear()
+        var first = createTemporaryObject(asynchronousIcon, testCase)
+        var second = createTemporaryObject(asynchronousIcon, testCase)
+        verify(first.status !== Kirigami.Icon.Error)
+        tryCompare(first, "status", Kirigami.Icon.Ready)
+        tryCompare(second, "status", Kirigami.Icon.Ready)
+        compare(first.paintedWidth, 48)
+        // Both icons were loaded by the same job
+        compare(Kirigami.IconCache.statistics().count, 1)
+    }
+
+    function test_prefetch() {
+        Kirigami.IconCache.clear()
+        Kirigami.IconCache.prefetch([Qt.resolvedUrl("../logo.png")], [16, 32])
+        tryVerify(function() { return Kirigami.IconCache.statistics().count === 2 })
+    }
+
+    // Icons prefetched for a window are found by the Icons of that window
+    function test_prefetchWindow() {
+        Kirigami.IconCache.clear()
+        Kirigami.IconCache.prefetch([Qt.resolvedUrl("../logo.png")], [32], testCase.Window.window)
+        tryVerify(function() { return Kirigami.IconCache.statistics().count === 1 })
+
+        var hits = Kirigami.IconCache.statistics().hits
+        var icon = createTemporaryObject(fileIcon, testCase)
+        verify(waitForRendering(icon))
+        verify(Kirigami.IconCache.statistics().hits > hits)
+        compare(Kirigami.IconCache.statistics().count, 1)
+    }
+
+    // Remote images are decoded in a worker thread, other sizes are downloaded again
+    function test_remote() {
+        var icon = createTemporaryObject(dataIcon, testCase)
+        tryCompare(icon, "status", Kirigami.Icon.Ready)
+
+        var count = Kirigami.IconCache.statistics().count
+        icon.width = 48
+        icon.height = 48
+        tryVerify(function() { return Kirigami.IconCache.statistics().count > count })
+        tryCompare(icon, "status", Kirigami.Icon.Ready)
+    }
+
+    // Remote images which can't be downloaded nor decoded end in the fallback icon
+    function test_remoteError() {
+        var icon = createTemporaryObject(unreachableIcon, testCase)
+        tryCompare(icon, "status", Kirigami.Icon.Error)
+    }
+
+    // Monochrome guesses are shared by icons with the same source and size
+    function test_monochromeCache() {
+        var first = createTemporaryObject(fileIcon, testCase)
+        verify(waitForRendering(first))
+
+        var hits = Kirigami.IconCache.statistics().monochromeHits
+        Kirigami.IconCache.clear()
+        var second = createTemporaryObject(fileIcon, testCase)
+        verify(waitForRendering(second))
+        verify(Kirigami.IconCache.statistics().monochromeHits > hits)
+    }
+
+    // Loading an icon which is not in the image cache, but whose monochrome guess is:
+    // creating, decoding and rendering it. The analysis itself is measured by iconcachebenchmark.
+    function benchmark_uncachedIcon() {
+        Kirigami.IconCache.clear()
+        var icon = fileIcon.createObject(testCase)
+        verify(waitForRendering(icon))
+        compare(icon.status, Kirigami.Icon.Ready)
+        icon.destroy()
+    }
 }
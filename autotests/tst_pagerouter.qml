@@ -5,8 +5,41 @@ import QtTest 1.0
 
 Kirigami.PageRow {
     id: root
+
+    // Pages of counted routes, by the counter property of the route
+    property var pagesCreated: ({})
+    property var pagesAlive: ({})
+    property var completionOrder: []
+
+    function pageCompleted(counter) {
+        completionOrder.push(counter)
+        pagesCreated[counter] = (pagesCreated[counter] || 0) + 1
+        pagesAlive[counter] = (pagesAlive[counter] || 0) + 1
+    }
+    function pageDestroyed(counter) {
+        pagesAlive[counter] -= 1
+    }
+
     TestCase {
         name: "PageRouterGeneralTests"
+
+        Item {
+            id: preloader
+            property var route
+            property bool active: false
+            Kirigami.PageRouter.router: router
+            Kirigami.PageRouter.preload.route: route
+            Kirigami.PageRouter.preload.when: active
+        }
+        Item {
+            id: secondPreloader
+            property var route
+            property bool active: false
+            Kirigami.PageRouter.router: router
+            Kirigami.PageRouter.preload.route: route
+            Kirigami.PageRouter.preload.when: active
+        }
+
         function test_a_init() {
             compare(router.currentRoutes().length, 1)
         }
@@ -57,6 +90,143 @@ Kirigami.PageRow {
             compare(router.currentRoutes().length, 1)
             compare(router.pageStack.count, 1)
         }
+        function test_k_navigation_keeps_prefix() {
+            router.navigateToRoute(["home", {"route": "login", "data": "red"}])
+            var home = router.pageStack.contentChildren[0]
+            var red = router.pageStack.contentChildren[1]
+            navigationSpy.clear()
+            router.navigateToRoute(["home", {"route": "login", "data": "red"}, {"route": "login", "data": "blue"}])
+            compare(navigationSpy.count, 1)
+            compare(navigationSpy.signalArguments[0][0], 2)
+            compare(navigationSpy.signalArguments[0][1], 2)
+            compare(router.pageStack.contentChildren[0], home)
+            compare(router.pageStack.contentChildren[1], red)
+            compare(router.pageStack.currentIndex, 2)
+
+            navigationSpy.clear()
+            router.navigateToRoute(["home", {"route": "login", "data": "blue"}])
+            compare(navigationSpy.count, 1)
+            compare(navigationSpy.signalArguments[0][0], 1)
+            compare(navigationSpy.signalArguments[0][1], 2)
+            compare(router.pageStack.contentChildren[0], home)
+            compare(router.pageStack.count, 2)
+        }
+        function test_l_predictive_preloading() {
+            router.predictivePreloading = true
+            router.navigateToRoute(["home"])
+            router.navigateToRoute(["home", "login"])
+            router.navigateToRoute(["home"])
+            compare(router.predictionStatistics().predictions, 0)
+            router.navigateToRoute(["home", "login"])
+            var stats = router.predictionStatistics()
+            compare(stats.predictions, 1)
+            compare(stats.hits, 1)
+            compare(stats.hitRate, 1)
+            compare(stats.transitions, 2)
+
+            router.clearPredictionHistory()
+            router.predictivePreloading = false
+            compare(router.predictionStatistics().transitions, 0)
+        }
+        // Unpreloaded routes are not served from the preload pool anymore
+        function test_m_unpreload_evicts() {
+            router.navigateToRoute(["home"])
+            preloader.route = {"route": "preloaded", "counter": "unpreloaded"}
+            preloader.active = true
+            tryVerify(function() { return root.pagesAlive["unpreloaded"] === 1 })
+
+            preloader.active = false
+            tryVerify(function() { return root.pagesAlive["unpreloaded"] === 0 })
+
+            router.pushRoute({"route": "preloaded", "counter": "unpreloaded"})
+            compare(root.pagesCreated["unpreloaded"], 2)
+            compare(root.pagesAlive["unpreloaded"], 1)
+            router.navigateToRoute(["home"])
+        }
+        // Numbers and the strings holding them are equal route data
+        function test_n_data_normalized() {
+            router.navigateToRoute(["home", {"route": "preloaded", "data": 1, "counter": "data"}])
+            var page = router.pageStack.contentChildren[1]
+            router.navigateToRoute(["home"])
+            router.navigateToRoute(["home", {"route": "preloaded", "data": "1", "counter": "data"}])
+            compare(router.pageStack.contentChildren[1], page)
+            compare(root.pagesCreated["data"], 1)
+            router.navigateToRoute(["home"])
+        }
+        // push() takes over a route being preloaded rather than creating it twice
+        function test_o_push_takes_over_preload() {
+            // Still in the queue
+            preloader.route = {"route": "preloaded", "data": "queued", "counter": "queued"}
+            preloader.active = true
+            router.pushRoute({"route": "preloaded", "data": "queued", "counter": "queued"})
+            compare(root.pagesCreated["queued"], 1)
+            // The queued duplicate is gone
+            wait(100)
+            compare(root.pagesCreated["queued"], 1)
+            compare(root.pagesAlive["queued"], 1)
+            preloader.active = false
+            router.navigateToRoute(["home"])
+
+            // Being incubated: the queue is processed on the next event loop iteration
+            preloader.route = {"route": "preloaded", "data": "incubated", "counter": "incubated"}
+            preloader.active = true
+            wait(0)
+            router.pushRoute({"route": "preloaded", "data": "incubated", "counter": "incubated"})
+            compare(root.pagesCreated["incubated"], 1)
+            compare(router.pageStack.contentChildren[1].counter, "incubated")
+            wait(100)
+            compare(root.pagesCreated["incubated"], 1)
+            preloader.active = false
+            router.navigateToRoute(["home"])
+        }
+        // unpreload() cancels routes in the queue as well as being incubated
+        function test_p_unpreload_cancels() {
+            preloader.route = {"route": "preloaded", "data": "cancelled", "counter": "cancelled"}
+            preloader.active = true
+            preloader.active = false
+            wait(100)
+            compare(root.pagesCreated["cancelled"], undefined)
+
+            preloader.active = true
+            wait(0)
+            preloader.active = false
+            wait(100)
+            compare(root.pagesAlive["cancelled"] || 0, 0)
+        }
+        // Preloads are incubated one at a time, in the order they were requested
+        function test_q_preload_queue() {
+            root.completionOrder = []
+            preloader.route = {"route": "preloaded", "data": "first", "counter": "first"}
+            secondPreloader.route = {"route": "preloaded", "data": "second", "counter": "second"}
+            preloader.active = true
+            secondPreloader.active = true
+            tryVerify(function() { return root.pagesAlive["second"] === 1 })
+            compare(root.completionOrder, ["first", "second"])
+            compare(root.pagesAlive["first"], 1)
+            preloader.active = false
+            secondPreloader.active = false
+        }
+    }
+    SignalSpy {
+        id: navigationSpy
+        target: router
+        signalName: "navigationChanged"
+    }
+    Component {
+        id: countedPage
+        Kirigami.Page {
+            property string counter
+            property bool completed: false
+            Component.onCompleted: {
+                completed = true
+                root.pageCompleted(counter)
+            }
+            Component.onDestruction: {
+                if (completed) {
+                    root.pageDestroyed(counter)
+                }
+            }
+        }
     }
     Kirigami.PageRouter {
         id: router
@@ -106,5 +276,10 @@ Kirigami.PageRow {
                 }
             }
         }
+        Kirigami.PageRoute {
+            name: "preloaded"
+            cache: true
+            component: countedPage
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+import QtQuick 2.12
+import QtQuick.Window 2.12
+import QtTest 1.0
+import org.kde.kirigami 2.15 as Kirigami
+
+TestCase {
+    id: testCase
+    name: "ShaderQualityTests"
+
+    width: 400
+    height: 400
+    visible: true
+
+    when: windowShown
+
+    Window {
+        id: window
+        width: 100
+        height: 100
+
+        Kirigami.ShadowedRectangle {
+            anchors.fill: parent
+            anchors.margins: 20
+            radius: 10
+            shadow.size: 10
+        }
+    }
+
+    Component {
+        id: animatedWindowComponent
+
+        Window {
+            width: 100
+            height: 100
+            visible: true
+
+            // Keeps the window rendering frames
+            Kirigami.ShadowedRectangle {
+                anchors.centerIn: parent
+                width: 50
+                height: 50
+                radius: 10
+                shadow.size: 10
+
+                RotationAnimation on rotation {
+                    from: 0
+                    to: 360
+                    duration: 1000
+                    loops: Animation.Infinite
+                }
+            }
+        }
+    }
+
+    SignalSpy {
+        id: lowPowerSpy
+        target: window.Kirigami.ShaderQuality
+        signalName: "lowPowerChanged"
+    }
+
+    function cleanup() {
+        window.Kirigami.ShaderQuality.mode = Kirigami.ShaderQuality.Automatic
+        window.Kirigami.ShaderQuality.warmUp = false
+        window.visible = false
+        lowPowerSpy.clear()
+    }
+
+    function test_forcedMode() {
+        window.Kirigami.ShaderQuality.mode = Kirigami.ShaderQuality.Standard
+        verify(!window.Kirigami.ShaderQuality.lowPower)
+
+        lowPowerSpy.clear()
+        window.Kirigami.ShaderQuality.mode = Kirigami.ShaderQuality.LowPower
+        verify(window.Kirigami.ShaderQuality.lowPower)
+        compare(lowPowerSpy.count, 1)
+
+        // Forcing the same variant again changes nothing
+        window.Kirigami.ShaderQuality.mode = Kirigami.ShaderQuality.LowPower
+        compare(lowPowerSpy.count, 1)
+
+        window.Kirigami.ShaderQuality.mode = Kirigami.ShaderQuality.Standard
+        verify(!window.Kirigami.ShaderQuality.lowPower)
+        compare(lowPowerSpy.count, 2)
+    }
+
+    function test_warmUp() {
+        window.Kirigami.ShaderQuality.warmUp = true
+        window.visible = true
+        waitForRendering(window.contentItem)
+
+        // The warm up item goes away once drawn, leaving only the rectangle
+        tryVerify(function() { return window.contentItem.children.length === 1 })
+    }
+
+    function createAnimatedWindow() {
+        var animatedWindow = createTemporaryObject(animatedWindowComponent, testCase)
+        verify(animatedWindow)
+        waitForRendering(animatedWindow.contentItem)
+        wait(50)
+
+        // Software rasterizers get the low power shaders for good
+        if (animatedWindow.Kirigami.ShaderQuality.lowPower) {
+            skip("The renderer is known to be low power: " + animatedWindow.Kirigami.ShaderQuality.renderer)
+        }
+        return animatedWindow
+    }
+
+    function test_downgrade() {
+        var quality = createAnimatedWindow().Kirigami.ShaderQuality
+        quality.minimumSamples = 5
+        quality.downgradeRatio = 1000
+        wait(200)
+        verify(!quality.lowPower)
+
+        // Every frame is now too slow
+        quality.downgradeRatio = 0
+        tryVerify(function() { return quality.lowPower })
+    }
+
+    function test_upgradeHysteresis() {
+        var quality = createAnimatedWindow().Kirigami.ShaderQuality
+        quality.minimumSamples = 1
+        quality.upgradeSamples = 1000000
+        quality.downgradeRatio = 0
+        tryVerify(function() { return quality.lowPower })
+
+        // Every frame is now in time, but not for long enough
+        quality.downgradeRatio = 1000
+        quality.upgradeRatio = 1000
+        wait(500)
+        verify(quality.lowPower)
+
+        quality.upgradeSamples = 5
+        tryVerify(function() { return !quality.lowPower })
+    }
+
+    function test_maximumDowngrades() {
+        var quality = createAnimatedWindow().Kirigami.ShaderQuality
+        quality.minimumSamples = 1
+        quality.upgradeSamples = 1
+        quality.maximumDowngrades = 1
+        quality.downgradeRatio = 0
+        tryVerify(function() { return quality.lowPower })
+
+        // Frames are in time, but the low power shaders are kept for good
+        quality.downgradeRatio = 1000
+        quality.upgradeRatio = 1000
+        wait(500)
+        verify(quality.lowPower)
+    }
+}
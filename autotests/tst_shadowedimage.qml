@@ -0,0 +1,99 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+import QtQuick 2.12
+import QtTest 1.0
+import org.kde.kirigami 2.15 as Kirigami
+
+TestCase {
+    id: testCase
+    name: "ShadowedImageTests"
+
+    width: 400
+    height: 400
+    visible: true
+
+    when: windowShown
+
+    Component { id: emptyImage; Kirigami.ShadowedImage { width: 100; height: 100 } }
+    Component { id: fileImage; Kirigami.ShadowedImage { width: 100; height: 100; radius: 10; source: Qt.resolvedUrl("../logo.png") } }
+    Component { id: scaledImage; Kirigami.ShadowedImage { width: 64; height: 64; sourceSize.width: 64; source: Qt.resolvedUrl("../logo.png") } }
+    Component { id: asynchronousImage; Kirigami.ShadowedImage { width: 48; height: 48; sourceSize: Qt.size(48, 48); asynchronous: true; source: Qt.resolvedUrl("../logo.png") } }
+    Component { id: largeImage; Kirigami.ShadowedImage { width: 100; height: 100; sourceSize: Qt.size(120, 120); asynchronous: true; source: Qt.resolvedUrl("../logo.png") } }
+    Component { id: missingImage; Kirigami.ShadowedImage { width: 100; height: 100; source: Qt.resolvedUrl("does-not-exist.png") } }
+
+    function test_empty() {
+        var image = createTemporaryObject(emptyImage, testCase)
+        verify(waitForRendering(image))
+        compare(image.status, Kirigami.ShadowedImage.Null)
+        compare(image.sourceSize.width, 0)
+        compare(image.sourceSize.height, 0)
+    }
+
+    // Without sourceSize, the image is decoded at its own size, which sourceSize reads as
+    function test_naturalSize() {
+        var image = createTemporaryObject(fileImage, testCase)
+        verify(waitForRendering(image))
+        compare(image.status, Kirigami.ShadowedImage.Ready)
+        compare(image.sourceSize.width, 128)
+        compare(image.sourceSize.height, 128)
+    }
+
+    // A dimension left unset follows the aspect ratio of the image
+    function test_sourceSize() {
+        var image = createTemporaryObject(scaledImage, testCase)
+        verify(waitForRendering(image))
+        compare(image.status, Kirigami.ShadowedImage.Ready)
+        compare(image.sourceSize.width, 64)
+
+        image.sourceSize = Qt.size(32, 32)
+        compare(image.status, Kirigami.ShadowedImage.Ready)
+        compare(image.sourceSize.width, 32)
+        compare(image.sourceSize.height, 32)
+    }
+
+    property int iconCacheCost: Kirigami.IconCache.maximumCost
+
+    function cleanup() {
+        Kirigami.IconCache.maximumCost = iconCacheCost
+    }
+
+    // Identical images are decoded once, by the same job, and don't fill the icon cache
+    function test_asynchronous() {
+        Kirigami.IconCache.clear()
+        var first = createTemporaryObject(asynchronousImage, testCase)
+        var second = createTemporaryObject(asynchronousImage, testCase)
+        compare(first.status, Kirigami.ShadowedImage.Loading)
+        tryCompare(first, "status", Kirigami.ShadowedImage.Ready)
+        tryCompare(second, "status", Kirigami.ShadowedImage.Ready)
+        compare(Kirigami.IconCache.statistics().count, 0)
+        verify(waitForRendering(second))
+    }
+
+    // Images larger than the whole icon cache still load asynchronously
+    function test_largerThanIconCache() {
+        Kirigami.IconCache.clear()
+        // In kilobytes, while the image takes about 56
+        Kirigami.IconCache.maximumCost = 1
+        var first = createTemporaryObject(largeImage, testCase)
+        var second = createTemporaryObject(largeImage, testCase)
+        compare(first.status, Kirigami.ShadowedImage.Loading)
+        tryCompare(first, "status", Kirigami.ShadowedImage.Ready)
+        tryCompare(second, "status", Kirigami.ShadowedImage.Ready)
+        compare(first.sourceSize.width, 120)
+        compare(second.sourceSize.width, 120)
+        verify(waitForRendering(second))
+    }
+
+    function test_error() {
+        var image = createTemporaryObject(missingImage, testCase)
+        compare(image.status, Kirigami.ShadowedImage.Error)
+        verify(waitForRendering(image))
+
+        image.source = Qt.resolvedUrl("../logo.png")
+        compare(image.status, Kirigami.ShadowedImage.Ready)
+    }
+}
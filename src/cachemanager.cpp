@@ -0,0 +1,159 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "cachemanager.h"
+
+#include <QQuickItem>
+
+#include <algorithm>
+
+// A QML object with its private data, bindings and signal handlers
+static const qint64 s_objectSize = 1024;
+
+CacheManager::CacheManager(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CacheManager *CacheManager::instance()
+{
+    // Never deleted: caches living in global statics unregister
+    // themselves at exit, in no particular order
+    static CacheManager *s_instance = new CacheManager;
+    return s_instance;
+}
+
+qint64 CacheManager::budget() const
+{
+    return m_budget;
+}
+
+void CacheManager::setBudget(qint64 budget)
+{
+    budget = qMax<qint64>(0, budget);
+    if (budget == m_budget) {
+        return;
+    }
+
+    m_budget = budget;
+    Q_EMIT budgetChanged();
+    enforceBudget();
+}
+
+qint64 CacheManager::totalCost() const
+{
+    qint64 cost = 0;
+    for (auto cache : m_caches) {
+        cost += cache->cacheCost();
+    }
+    return cost;
+}
+
+void CacheManager::registerCache(ManagedCache *cache)
+{
+    if (m_caches.contains(cache)) {
+        return;
+    }
+
+    // Kept sorted by priority, in insertion order for the same priority
+    auto it = std::upper_bound(m_caches.begin(), m_caches.end(), cache, [](ManagedCache *a, ManagedCache *b) {
+        return a->cachePriority() < b->cachePriority();
+    });
+    m_caches.insert(it, cache);
+}
+
+void CacheManager::unregisterCache(ManagedCache *cache)
+{
+    m_caches.removeAll(cache);
+}
+
+void CacheManager::cacheChanged(ManagedCache *cache)
+{
+    Q_UNUSED(cache)
+
+    // Trimming makes caches report their changes too
+    if (m_enforcing) {
+        return;
+    }
+    enforceBudget();
+}
+
+qint64 CacheManager::estimateSize(const QObject *object)
+{
+    if (!object) {
+        return 0;
+    }
+
+    qint64 size = s_objectSize;
+    const auto children = object->children();
+    for (auto child : children) {
+        size += estimateSize(child);
+    }
+    // Items created by a component are usually children of their parent item,
+    // only count the other ones
+    if (auto item = qobject_cast<const QQuickItem *>(object)) {
+        const auto childItems = item->childItems();
+        for (auto child : childItems) {
+            if (child->parent() != object) {
+                size += estimateSize(child);
+            }
+        }
+    }
+    return size;
+}
+
+void CacheManager::trim(TrimLevel level)
+{
+    m_enforcing = true;
+    for (auto cache : qAsConst(m_caches)) {
+        cache->trimCache(level == Critical ? 0 : cache->cacheCost() / 2);
+    }
+    m_enforcing = false;
+
+    const qint64 cost = totalCost();
+    if (cost != m_lastTotalCost) {
+        m_lastTotalCost = cost;
+        Q_EMIT totalCostChanged();
+    }
+}
+
+QVariantList CacheManager::statistics() const
+{
+    QVariantList ret;
+    ret.reserve(m_caches.count());
+    for (auto cache : m_caches) {
+        ret << QVariantMap{
+            {QStringLiteral("name"), cache->cacheName()},
+            {QStringLiteral("priority"), cache->cachePriority()},
+            {QStringLiteral("cost"), cache->cacheCost()},
+            {QStringLiteral("count"), cache->cacheCount()},
+        };
+    }
+    return ret;
+}
+
+void CacheManager::enforceBudget()
+{
+    qint64 cost = totalCost();
+
+    if (m_budget > 0 && cost > m_budget) {
+        m_enforcing = true;
+        for (auto cache : qAsConst(m_caches)) {
+            if (cost <= m_budget) {
+                break;
+            }
+            const qint64 cacheCost = cache->cacheCost();
+            cache->trimCache(qMax<qint64>(0, cacheCost - (cost - m_budget)));
+            cost += cache->cacheCost() - cacheCost;
+        }
+        m_enforcing = false;
+    }
+
+    if (cost != m_lastTotalCost) {
+        m_lastTotalCost = cost;
+        Q_EMIT totalCostChanged();
+    }
+}
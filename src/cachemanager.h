@@ -0,0 +1,148 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVariant>
+
+/**
+ * Interface of the caches coordinated by CacheManager.
+ *
+ * Costs are estimated sizes in bytes, whatever the cache holds, so that
+ * they can be added up and compared to a single budget: the size of the
+ * images of the image caches, and CacheManager::estimateSize() of the
+ * objects of PagePool, PageRouter and the delegate recycler.
+ */
+class ManagedCache
+{
+public:
+    virtual ~ManagedCache() = default;
+
+    /**
+     * A human readable name, used in statistics.
+     */
+    virtual QString cacheName() const = 0;
+
+    /**
+     * Caches with a lower priority are trimmed first.
+     */
+    virtual int cachePriority() const = 0;
+
+    /**
+     * The estimated size, in bytes, of what the cache currently holds.
+     */
+    virtual qint64 cacheCost() const = 0;
+
+    /**
+     * How many entries the cache currently holds.
+     */
+    virtual int cacheCount() const = 0;
+
+    /**
+     * Drops entries until the cost is at most @p maximumCost bytes,
+     * or until nothing more can be dropped.
+     */
+    virtual void trimCache(qint64 maximumCost) = 0;
+};
+
+/**
+ * Coordinates the caches of Kirigami: PagePool, PageRouter, the
+ * DelegateRecycler pool and the caches of rasterized images.
+ *
+ * Every cache registers itself on creation. When budget is set, the
+ * combined estimated size of all caches is kept under it by trimming the
+ * caches in priority order, speculative ones such as preloaded routes first.
+ * Applications can also release memory on demand, for instance when the
+ * platform signals memory pressure:
+ *
+ * @code{.qml}
+ * Connections {
+ *     target: app
+ *     function onLowMemory() {
+ *         Kirigami.CacheManager.trim(Kirigami.CacheManager.Critical)
+ *     }
+ * }
+ * @endcode
+ *
+ * @since 5.78
+ * @since org.kde.kirigami 2.15
+ */
+class CacheManager : public QObject
+{
+    Q_OBJECT
+
+    /**
+     * The maximum combined cost of all the caches, in bytes.
+     * 0, the default, means unbounded.
+     */
+    Q_PROPERTY(qint64 budget READ budget WRITE setBudget NOTIFY budgetChanged)
+
+    /**
+     * The combined cost of all the caches, in bytes.
+     */
+    Q_PROPERTY(qint64 totalCost READ totalCost NOTIFY totalCostChanged)
+
+public:
+    enum TrimLevel {
+        Moderate = 0, /// Halve every cache
+        Critical = 1 /// Empty every cache, as far as possible
+    };
+    Q_ENUM(TrimLevel)
+
+    static CacheManager *instance();
+
+    qint64 budget() const;
+    void setBudget(qint64 budget);
+
+    qint64 totalCost() const;
+
+    void registerCache(ManagedCache *cache);
+    void unregisterCache(ManagedCache *cache);
+
+    /**
+     * To be called by a registered cache when its cost grew, so that the
+     * budget can be enforced.
+     */
+    void cacheChanged(ManagedCache *cache);
+
+    /**
+     * A rough estimate of the memory taken by @p object and the objects and
+     * items it owns, for the caches of objects. It only counts objects,
+     * at an average size for a QML object with its bindings, not the
+     * resources they may hold, such as textures.
+     */
+    static qint64 estimateSize(const QObject *object);
+
+    /**
+     * Releases cached objects.
+     *
+     * @param level how aggressively to trim, see TrimLevel
+     */
+    Q_INVOKABLE void trim(TrimLevel level = Moderate);
+
+    /**
+     * @returns a list with an entry per registered cache, each a map
+     * with the keys `name`, `priority`, `cost`, in bytes, and `count`,
+     * in trimming order.
+     */
+    Q_INVOKABLE QVariantList statistics() const;
+
+Q_SIGNALS:
+    void budgetChanged();
+    void totalCostChanged();
+
+private:
+    explicit CacheManager(QObject *parent = nullptr);
+
+    void enforceBudget();
+
+    QList<ManagedCache *> m_caches;
+    qint64 m_budget = 0;
+    qint64 m_lastTotalCost = 0;
+    bool m_enforcing = false;
+};
@@ -1083,21 +1083,37 @@ void ColumnView::addItem(QQuickItem *item)
 
 void ColumnView::insertItem(int pos, QQuickItem *item)
 {
-    if (!item || m_contentItem->m_items.contains(item)) {
-        return;
-    }
+    insertItems(pos, {item});
+}
 
-    m_contentItem->m_items.insert(qBound(0, pos, m_contentItem->m_items.length()), item);
+void ColumnView::insertItems(int pos, const QList<QQuickItem *> &items)
+{
+    QList<QQuickItem *> inserted;
+    inserted.reserve(items.count());
 
-    connect(item, &QObject::destroyed, m_contentItem, [this, item]() {
-        removeItem(item);
-    });
-    ColumnViewAttached *attached = qobject_cast<ColumnViewAttached *>(qmlAttachedPropertiesObject<ColumnView>(item, true));
-    attached->setOriginalParent(item->parentItem());
-    attached->setShouldDeleteOnRemove(item->parentItem() == nullptr && QQmlEngine::objectOwnership(item) == QQmlEngine::JavaScriptOwnership);
-    item->setParentItem(m_contentItem);
+    for (QQuickItem *item : items) {
+        if (!item || m_contentItem->m_items.contains(item)) {
+            continue;
+        }
+
+        m_contentItem->m_items.insert(qBound(0, pos + inserted.count(), m_contentItem->m_items.length()), item);
 
-    item->forceActiveFocus();
+        connect(item, &QObject::destroyed, m_contentItem, [this, item]() {
+            removeItem(item);
+        });
+        ColumnViewAttached *attached = qobject_cast<ColumnViewAttached *>(qmlAttachedPropertiesObject<ColumnView>(item, true));
+        attached->setOriginalParent(item->parentItem());
+        attached->setShouldDeleteOnRemove(item->parentItem() == nullptr && QQmlEngine::objectOwnership(item) == QQmlEngine::JavaScriptOwnership);
+        item->setParentItem(m_contentItem);
+
+        inserted << item;
+    }
+
+    if (inserted.isEmpty()) {
+        return;
+    }
+
+    inserted.last()->forceActiveFocus();
     // We layout immediately to be sure all geometries are final after the return of this call
     m_contentItem->m_shouldAnimate = false;
     m_contentItem->layoutItems();
@@ -1106,11 +1122,13 @@ void ColumnView::insertItem(int pos, QQuickItem *item)
     // In order to keep the same current item we need to increase the current index if displaced
     // NOTE: just updating m_currentIndex does *not* update currentItem (which is what we need atm) while setCurrentIndex will update also currentItem
     if (m_currentIndex >= pos) {
-        ++m_currentIndex;
+        m_currentIndex += inserted.count();
         emit currentIndexChanged();
     }
 
-    emit itemInserted(pos, item);
+    for (int i = 0; i < inserted.count(); ++i) {
+        emit itemInserted(pos + i, inserted[i]);
+    }
 }
 
 void ColumnView::moveItem(int from, int to)
@@ -320,6 +320,13 @@ public:
     QQuickItem *removeItem(QQuickItem *item);
     QQuickItem *removeItem(int item);
 
+    /**
+     * Inserts several items at once starting at a given position.
+     * Behaves like insertItem, but the view is laid out only once
+     * and only the last item gets the focus.
+     */
+    void insertItems(int pos, const QList<QQuickItem *> &items);
+
     // QML attached property
     static ColumnViewAttached *qmlAttachedProperties(QObject *object);
 
@@ -8,6 +8,7 @@ import QtQuick 2.12
 import QtQuick.Controls 2.0 as QQC2
 import "templates/private"
 import org.kde.kirigami 2.4
+import org.kde.kirigami 2.15 as Kirigami
 import QtGraphicalEffects 1.0
 
 /**
@@ -79,6 +80,9 @@ QQC2.ApplicationWindow {
     LayoutMirroring.enabled: Qt.application.layoutDirection == Qt.RightToLeft
     LayoutMirroring.childrenInherit: true
 
+    // Compile the shaders of cards and sheets before they first show up
+    Kirigami.ShaderQuality.warmUp: true
+
     /**
      * Shows a little passive notification at the bottom of the app window
      * lasting for few seconds, with an optional action button.
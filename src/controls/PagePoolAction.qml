@@ -65,6 +65,16 @@ Kirigami.Action {
       */
     property bool useLayers: false
 
+    /**
+      * @since 5.78
+      * @since org.kde.kirigami 2.15
+      * When true the page is compiled and instantiated asynchronously using
+      * PagePool.loadPageAsynchronously, so that heavy pages don't block the
+      * user interface while being created. The page is pushed once it's ready.
+      * Triggering the action again before then cancels the pending load.
+      */
+    property bool asynchronous: false
+
     /**
       * @returns the page item held in the PagePool or null if it has not been loaded yet.
       */
@@ -125,7 +135,12 @@ Kirigami.Action {
             return;
         }
 
-        if (pagePool.isLocalUrl(page)) {
+        if (_private.pendingLoad) {
+            pagePool.cancelLoad(_private.pendingLoad)
+            _private.pendingLoad = 0
+        }
+
+        if (pagePool.isLocalUrl(page) && !asynchronous) {
             if (basePage) {
                 pageStack_.pop(basePage);
 
@@ -139,6 +154,7 @@ Kirigami.Action {
                                
         } else {
             var callback = function(item) {
+                _private.pendingLoad = 0
                 if (basePage) {
                     pageStack_.pop(basePage);
 
@@ -148,8 +164,11 @@ Kirigami.Action {
                 pageStack_.push(item);
             };
 
-            if (initialProperties) {
-                pagePool.loadPage(page, initialProperties, callback);
+            if (asynchronous) {
+                _private.pendingLoad = pagePool.loadPageAsynchronously(page, initialProperties || {}, callback);
+
+            } else if (initialProperties) {
+                pagePool.loadPageWithProperties(page, initialProperties, callback);
 
             } else {
                 pagePool.loadPage(page, callback);
@@ -161,6 +180,8 @@ Kirigami.Action {
     property QtObject _private: QtObject {
         id: _private
 
+        property int pendingLoad: 0
+
         function setChecked(checked) {
             root.checked = checked
         }
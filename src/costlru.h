@@ -0,0 +1,161 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+
+/**
+ * The recency order and the costs of the entries of an LRU cache.
+ *
+ * Keys are kept both in a hash, for lookups, and in a doubly linked list
+ * ordered from the most to the least recently used, so that every operation
+ * is O(1) and the total cost is kept up to date rather than summed again.
+ * The cached values themselves are left to the owner of the list, which
+ * decides what can be evicted.
+ */
+template<typename Key>
+class CostLru
+{
+public:
+    struct Node {
+        Key key;
+        int cost = 0;
+        Node *previous = nullptr;
+        Node *next = nullptr;
+    };
+
+    CostLru() = default;
+    ~CostLru()
+    {
+        clear();
+    }
+    Q_DISABLE_COPY(CostLru)
+
+    // Most recently used
+    const Node *first() const
+    {
+        return m_first;
+    }
+
+    // Least recently used, next to be evicted
+    const Node *last() const
+    {
+        return m_last;
+    }
+
+    int count() const
+    {
+        return m_nodes.count();
+    }
+
+    int totalCost() const
+    {
+        return m_totalCost;
+    }
+
+    bool contains(const Key &key) const
+    {
+        return m_nodes.contains(key);
+    }
+
+    QList<Key> keys() const
+    {
+        QList<Key> ret;
+        ret.reserve(m_nodes.count());
+        for (auto node = m_first; node; node = node->next) {
+            ret << node->key;
+        }
+        return ret;
+    }
+
+    /**
+     * Makes key the most recently used, adding it if needed, and sets its cost.
+     * @returns whether anything changed
+     */
+    bool touch(const Key &key, int cost)
+    {
+        Node *node = m_nodes.value(key);
+        if (node && node == m_first && node->cost == cost) {
+            return false;
+        }
+
+        if (node) {
+            unlink(node);
+        } else {
+            node = new Node;
+            node->key = key;
+            m_nodes.insert(key, node);
+        }
+        m_totalCost += cost - node->cost;
+        node->cost = cost;
+
+        node->next = m_first;
+        if (m_first) {
+            m_first->previous = node;
+        }
+        m_first = node;
+        if (!m_last) {
+            m_last = node;
+        }
+        return true;
+    }
+
+    /**
+     * Changes the cost of key, without changing its place in the list.
+     */
+    void setCost(const Key &key, int cost)
+    {
+        if (Node *node = m_nodes.value(key)) {
+            m_totalCost += cost - node->cost;
+            node->cost = cost;
+        }
+    }
+
+    bool remove(const Key &key)
+    {
+        Node *node = m_nodes.take(key);
+        if (!node) {
+            return false;
+        }
+        unlink(node);
+        m_totalCost -= node->cost;
+        delete node;
+        return true;
+    }
+
+    void clear()
+    {
+        qDeleteAll(m_nodes);
+        m_nodes.clear();
+        m_first = nullptr;
+        m_last = nullptr;
+        m_totalCost = 0;
+    }
+
+private:
+    void unlink(Node *node)
+    {
+        if (node->previous) {
+            node->previous->next = node->next;
+        } else {
+            m_first = node->next;
+        }
+        if (node->next) {
+            node->next->previous = node->previous;
+        } else {
+            m_last = node->previous;
+        }
+        node->previous = nullptr;
+        node->next = nullptr;
+    }
+
+    Node *m_first = nullptr;
+    Node *m_last = nullptr;
+    QHash<Key, Node *> m_nodes;
+    int m_totalCost = 0;
+};
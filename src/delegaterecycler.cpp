@@ -6,6 +6,7 @@
  */
 
 #include "delegaterecycler.h"
+#include "cachemanager.h"
 
 #include <QQmlComponent>
 #include <QQmlContext>
@@ -33,7 +34,7 @@ DelegateRecycler *recycler() const
 
 
 
-class DelegateCache
+class DelegateCache : public ManagedCache
 {
 public:
     DelegateCache();
@@ -45,20 +46,33 @@ public:
     void insert(QQmlComponent *, QQuickItem *);
     QQuickItem *take(QQmlComponent *);
 
+    QString cacheName() const override;
+    int cachePriority() const override;
+    qint64 cacheCost() const override;
+    int cacheCount() const override;
+    void trimCache(qint64 maximumCost) override;
+
 private:
+    void deleteItem(QQuickItem *item);
+
     static const int s_cacheSize = 40;
     QHash<QQmlComponent *, int> m_refs;
     QHash<QQmlComponent *, QList<QQuickItem *> > m_unusedItems;
+    // The estimated sizes of the unused items, measured when pooled
+    QHash<QQuickItem *, qint64> m_sizes;
+    qint64 m_size = 0;
 };
 
 Q_GLOBAL_STATIC(DelegateCache, s_delegateCache)
 
 DelegateCache::DelegateCache()
 {
+    CacheManager::instance()->registerCache(this);
 }
 
 DelegateCache::~DelegateCache()
 {
+    CacheManager::instance()->unregisterCache(this);
     for (auto& item : qAsConst(m_unusedItems)) {
         qDeleteAll(item);
     }
@@ -80,7 +94,10 @@ void DelegateCache::deref(QQmlComponent *component)
     if (*itRef <= 0) {
         m_refs.erase(itRef);
 
-        qDeleteAll(m_unusedItems.take(component));
+        const auto items = m_unusedItems.take(component);
+        for (auto item : items) {
+            deleteItem(item);
+        }
     }
 }
 
@@ -99,17 +116,67 @@ void DelegateCache::insert(QQmlComponent *component, QQuickItem *item)
 
     item->setParentItem(nullptr);
     items.append(item);
+    const qint64 size = CacheManager::estimateSize(item);
+    m_sizes.insert(item, size);
+    m_size += size;
+    CacheManager::instance()->cacheChanged(this);
 }
 
 QQuickItem *DelegateCache::take(QQmlComponent *component)
 {
     auto it = m_unusedItems.find(component);
     if (it != m_unusedItems.end() && !it->isEmpty()) {
-        return it->takeFirst();
+        QQuickItem *item = it->takeFirst();
+        m_size -= m_sizes.take(item);
+        return item;
     }
     return nullptr;
 }
 
+void DelegateCache::deleteItem(QQuickItem *item)
+{
+    m_size -= m_sizes.take(item);
+    delete item;
+}
+
+QString DelegateCache::cacheName() const
+{
+    return QStringLiteral("DelegateRecycler");
+}
+
+int DelegateCache::cachePriority() const
+{
+    return 10;
+}
+
+qint64 DelegateCache::cacheCost() const
+{
+    return m_size;
+}
+
+int DelegateCache::cacheCount() const
+{
+    return m_sizes.count();
+}
+
+void DelegateCache::trimCache(qint64 maximumCost)
+{
+    // Take from every component in turn, so that none loses all of its items first
+    bool trimmed = true;
+    while (m_size > maximumCost && trimmed) {
+        trimmed = false;
+        for (auto &items : m_unusedItems) {
+            if (m_size <= maximumCost) {
+                break;
+            }
+            if (!items.isEmpty()) {
+                deleteItem(items.takeLast());
+                trimmed = true;
+            }
+        }
+    }
+}
+
 
 
 
@@ -6,9 +6,12 @@
  */
 
 #include "icon.h"
+#include "iconcache.h"
 #include "libkirigami/platformtheme.h"
 #include "scenegraph/managedtexturenode.h"
+#include "scenegraph/tintedtexturenode.h"
 
+#include <QSGRendererInterface>
 #include <QSGSimpleTextureNode>
 #include <QQuickWindow>
 #include <QIcon>
@@ -26,6 +29,10 @@
 
 Q_GLOBAL_STATIC(ImageTexturesCache, s_iconImageCache)
 
+// Icons up to this size, in pixels, go in the scene graph's texture atlas,
+// so that lists and toolbars full of small icons can be batched together
+static const int s_atlasSizeLimit = 128;
+
 Icon::Icon(QQuickItem *parent)
     : QQuickItem(parent),
       m_changed(false),
@@ -53,7 +60,6 @@ void Icon::setSource(const QVariant &icon)
         return;
     }
     m_source = icon;
-    m_monochromeHeuristics.clear();
 
     if (!m_theme) {
         m_theme = static_cast<Kirigami::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::PlatformTheme>(this, true));
@@ -75,6 +81,8 @@ void Icon::setSource(const QVariant &icon)
         m_networkReply->close();
     }
     m_loadedImage = QImage();
+    m_remoteData.clear();
+    m_downloaded = false;
     setStatus(Loading);
 
     polish();
@@ -172,15 +180,15 @@ QSGNode* Icon::updatePaintNode(QSGNode* node, QQuickItem::UpdatePaintNodeData* /
         const QSize itemSize(width(), height());
         QRect nodeRect(QPoint(0,0), itemSize);
 
-        ManagedTextureNode* mNode = dynamic_cast<ManagedTextureNode*>(node);
-        if (!mNode) {
-            delete node;
-            mNode = new ManagedTextureNode;
-        }
+        QSharedPointer<QSGTexture> texture;
         if (itemSize.width() != 0 && itemSize.height() != 0) {
             const auto multiplier = QCoreApplication::instance()->testAttribute(Qt::AA_UseHighDpiPixmaps) ? 1 : (window() ? window()->devicePixelRatio() : qGuiApp->devicePixelRatio());
             const QSize size = itemSize * multiplier;
-            mNode->setTexture(s_iconImageCache->loadTexture(window(), m_icon));
+            QQuickWindow::CreateTextureOptions options;
+            if (m_icon.width() <= s_atlasSizeLimit && m_icon.height() <= s_atlasSizeLimit) {
+                options |= QQuickWindow::TextureCanUseAtlas;
+            }
+            texture = s_iconImageCache->loadTexture(window(), m_icon, options);
             if (m_icon.size() != size) {
                 // At this point, the image will already be scaled, but we need to output it in
                 // the correct aspect ratio, painted centered in the viewport. So:
@@ -189,10 +197,32 @@ QSGNode* Icon::updatePaintNode(QSGNode* node, QQuickItem::UpdatePaintNodeData* /
                 nodeRect = destination;
             }
         }
-        mNode->setRect(nodeRect);
-        node = mNode;
-        if (smooth()) {
-            mNode->setFiltering(QSGTexture::Linear);
+
+        if (m_tintInShader) {
+            TintedTextureNode* tNode = dynamic_cast<TintedTextureNode*>(node);
+            if (!tNode) {
+                delete node;
+                tNode = new TintedTextureNode;
+            }
+            tNode->setTexture(texture);
+            tNode->setRect(nodeRect);
+            tNode->setColor(m_tintColor);
+            if (smooth()) {
+                tNode->setFiltering(QSGTexture::Linear);
+            }
+            node = tNode;
+        } else {
+            ManagedTextureNode* mNode = dynamic_cast<ManagedTextureNode*>(node);
+            if (!mNode) {
+                delete node;
+                mNode = new ManagedTextureNode;
+            }
+            mNode->setTexture(texture);
+            mNode->setRect(nodeRect);
+            node = mNode;
+            if (smooth()) {
+                mNode->setFiltering(QSGTexture::Linear);
+            }
         }
         m_changed = false;
     }
@@ -241,15 +271,11 @@ void Icon::handleFinished(QNetworkReply* reply)
         return;
     }
 
-    m_loadedImage = QImage();
-
-    const QString filename = reply->url().fileName();
-    if (!m_loadedImage.load(reply, filename.mid(filename.indexOf(QLatin1Char('.'))).toLatin1().constData())) {
-        qWarning() << "received broken image" << reply->url();
-
-        // broken image from data, inform the user of this with some useful broken-image thing...
-        m_loadedImage = QIcon::fromTheme(m_fallback).pixmap(window(), QSize(width(), height()), iconMode(), QIcon::On).toImage();
-    }
+    // Only keep the encoded data: IconCache decodes it in a worker thread,
+    // right at the size it is needed
+    m_remoteData = reply->readAll();
+    m_downloaded = true;
+    m_asyncFailed = false;
     polish();
 }
 
@@ -268,6 +294,49 @@ void Icon::updatePolish()
     if (itemSize.width() != 0 && itemSize.height() != 0) {
         const auto multiplier = QCoreApplication::instance()->testAttribute(Qt::AA_UseHighDpiPixmaps) ? 1 : (window() ? window()->devicePixelRatio() : qGuiApp->devicePixelRatio());
         const QSize size = itemSize * multiplier;
+        const QColor tintColor = !m_color.isValid() || m_color == Qt::transparent ? (m_selected ? m_theme->highlightedTextColor() : m_theme->textColor()) : m_color;
+        // Unless rendering in software, monochrome icons are tinted by a shader,
+        // so that a color change doesn't need a new image nor a new texture
+        const bool shaderTint = window() && window()->rendererInterface()->graphicsApi() != QSGRendererInterface::Software;
+        m_tintColor = tintColor;
+
+        // Icons from the theme, files and resources are shared between instances
+        IconCacheKey cacheKey;
+        const bool cacheable = isCacheable();
+        if (cacheable) {
+            cacheKey.source = m_source.toString();
+            cacheKey.size = size;
+            cacheKey.devicePixelRatio = window() ? window()->devicePixelRatio() : qGuiApp->devicePixelRatio();
+            cacheKey.mode = iconMode();
+            cacheKey.tint = shaderTint ? 0 : tintColor.rgba();
+            cacheKey.mask = isMask();
+            cacheKey.themeName = QIcon::themeName();
+            IconCache::setPlatformColors(cacheKey, m_theme, m_color);
+
+            const IconImage cached = IconCache::instance()->find(cacheKey);
+            if (!cached.image.isNull()) {
+                m_icon = cached.image;
+                m_tintInShader = shaderTint && cached.tintable && tintColor.alpha() > 0;
+                setStatus(Ready);
+                m_changed = true;
+                updatePaintedGeometry();
+                update();
+                return;
+            }
+
+            if ((m_asynchronous || isRemote()) && requestAsynchronously(cacheKey, shaderTint ? QColor() : tintColor)) {
+                // Keep showing the previous image, if any
+                if (m_icon.isNull()) {
+                    m_icon = QIcon::fromTheme(m_placeholder).pixmap(window(), size, iconMode(), QIcon::On).toImage();
+                    m_tintInShader = false;
+                }
+                setStatus(Loading);
+                m_changed = true;
+                updatePaintedGeometry();
+                update();
+                return;
+            }
+        }
 
         switch(m_source.type()){
         case QVariant::Pixmap:
@@ -301,15 +370,19 @@ void Icon::updatePolish()
             m_icon.fill(Qt::transparent);
         }
 
-        const QColor tintColor = !m_color.isValid() || m_color == Qt::transparent ? (m_selected ? m_theme->highlightedTextColor() : m_theme->textColor()) : m_color;
-
         //TODO: initialize m_isMask with icon.isMask()
-        if (tintColor.alpha() > 0 && (isMask() || guessMonochrome(m_icon))) {
+        const bool tintable = isMask() || guessMonochrome(m_icon);
+        m_tintInShader = shaderTint && tintable && tintColor.alpha() > 0;
+        if (!shaderTint && tintable && tintColor.alpha() > 0) {
             QPainter p(&m_icon);
             p.setCompositionMode(QPainter::CompositionMode_SourceIn);
             p.fillRect(m_icon.rect(), tintColor);
             p.end();
         }
+
+        if (cacheable && m_status == Ready) {
+            IconCache::instance()->insert(cacheKey, {m_icon, tintable});
+        }
     }
     m_changed = true;
     updatePaintedGeometry();
@@ -392,11 +465,27 @@ QImage Icon::findIcon(const QSize &size)
             setStatus(Error);
             break;
         }
-    } else if(iconSource.startsWith(QLatin1String("http://")) || iconSource.startsWith(QLatin1String("https://"))) {
-        if(!m_loadedImage.isNull()) {
+    } else if(isRemote()) {
+        if (m_downloaded) {
+            // IconCache couldn't decode it
+            qWarning() << "received broken image" << m_source;
+
+            // broken image from data, inform the user of this with some useful broken-image thing...
+            setStatus(Error);
+            return QIcon::fromTheme(m_fallback).pixmap(window(), QSize(width(), height()), iconMode(), QIcon::On).toImage();
+        }
+
+        // Decoded in a previous run
+        IconCacheKey thumbnailKey;
+        thumbnailKey.source = iconSource;
+        thumbnailKey.size = size;
+        thumbnailKey.devicePixelRatio = window() ? window()->devicePixelRatio() : qGuiApp->devicePixelRatio();
+        img = IconCache::instance()->loadThumbnail(thumbnailKey, QCoreApplication::instance()->testAttribute(Qt::AA_UseHighDpiPixmaps));
+        if (!img.isNull()) {
             setStatus(Ready);
-            return m_loadedImage.scaled(size, Qt::KeepAspectRatio, smooth() ? Qt::SmoothTransformation : Qt::FastTransformation );
+            return img;
         }
+
         const auto url = m_source.toUrl();
         QQmlEngine* engine = qmlEngine(this);
         QNetworkAccessManager* qnam;
@@ -409,8 +498,10 @@ QImage Icon::findIcon(const QSize &size)
                     handleFinished(m_networkReply);
             });
         }
-        // Temporary icon while we wait for the real image to load...
-        img = QIcon::fromTheme(m_placeholder).pixmap(window(), size, iconMode(), QIcon::On).toImage();
+        // Keep showing the previous size while downloading another one,
+        // otherwise a temporary icon while we wait for the real image to load...
+        setStatus(Loading);
+        img = m_icon.isNull() ? QIcon::fromTheme(m_placeholder).pixmap(window(), size, iconMode(), QIcon::On).toImage() : m_icon;
     } else {
         if (iconSource.startsWith(QLatin1String("qrc:/"))) {
             iconSource = iconSource.mid(3);
@@ -449,6 +540,102 @@ QImage Icon::findIcon(const QSize &size)
     return img;
 }
 
+bool Icon::requestAsynchronously(const IconCacheKey &key, const QColor &tintColor)
+{
+    // Remote images don't depend on the mode
+    if ((key.mode != QIcon::Normal && !isRemote()) || (m_asyncFailed && key == m_asyncKey)) {
+        return false;
+    }
+
+    IconRequest request;
+    request.key = key;
+    request.source = key.source;
+    if (request.source.startsWith(QLatin1String("qrc:/"))) {
+        request.source = request.source.mid(3);
+    } else if (request.source.startsWith(QLatin1String("file:/"))) {
+        request.source = QUrl(request.source).path();
+    }
+    request.themeIcon = !request.source.contains(QLatin1String("/"));
+    // The platform theme may do more than QIcon::fromTheme
+    if (request.themeIcon && m_theme->supportsIconColoring()) {
+        return false;
+    }
+    if (isRemote()) {
+        // Nothing to decode until downloaded
+        if (!m_downloaded || m_remoteData.isEmpty()) {
+            return false;
+        }
+        request.data = m_remoteData;
+        request.thumbnailPath = IconCache::instance()->thumbnailPath(key, QCoreApplication::instance()->testAttribute(Qt::AA_UseHighDpiPixmaps));
+    }
+    request.themeSearchPaths = QIcon::themeSearchPaths();
+    request.tint = tintColor;
+    request.tintMonochrome = !m_theme->supportsIconColoring();
+    request.highDpiPixmaps = QCoreApplication::instance()->testAttribute(Qt::AA_UseHighDpiPixmaps);
+
+    if (!(key == m_asyncKey)) {
+        IconCache::instance()->cancelRequest(m_asyncKey, this);
+    }
+    m_asyncKey = key;
+    m_asyncFailed = false;
+    IconCache::instance()->requestImage(request, this, [this, key](const IconImage &image) {
+        asyncImageReady(key, image);
+    });
+    return true;
+}
+
+void Icon::asyncImageReady(const IconCacheKey &key, const IconImage &image)
+{
+    if (!(key == m_asyncKey)) {
+        return;
+    }
+
+    if (image.image.isNull()) {
+        // Let the synchronous code deal with fallbacks
+        m_asyncFailed = true;
+        polish();
+        return;
+    }
+
+    // Use the image as delivered: it may not be in the cache, if larger than
+    // its maximumCost or already evicted
+    m_icon = image.image;
+    if (isRemote()) {
+        // Don't hold the encoded original for the lifetime of the item: other
+        // sizes download it again, from the network cache when there is one
+        m_remoteData.clear();
+        m_downloaded = false;
+    }
+    // Keys of icons tinted by a shader have no tint
+    m_tintInShader = key.tint == 0 && image.tintable && m_tintColor.alpha() > 0;
+    setStatus(Ready);
+    m_changed = true;
+    updatePaintedGeometry();
+    update();
+}
+
+bool Icon::isCacheable() const
+{
+    if (m_source.type() != QVariant::String && m_source.type() != QVariant::Url) {
+        return false;
+    }
+    const QString iconSource = m_source.toString();
+    // Image providers may return anything for the same id
+    return !iconSource.isEmpty()
+        && !iconSource.startsWith(QLatin1String("image://"));
+}
+
+bool Icon::isRemote() const
+{
+    if (m_source.type() != QVariant::String && m_source.type() != QVariant::Url) {
+        return false;
+    }
+    const QString iconSource = m_source.toString();
+    // Data urls go through the network access manager too
+    return iconSource.startsWith(QLatin1String("http://")) || iconSource.startsWith(QLatin1String("https://"))
+        || iconSource.startsWith(QLatin1String("data:"));
+}
+
 QIcon::Mode Icon::iconMode() const
 {
     if (!isEnabled()) {
@@ -467,58 +654,16 @@ bool Icon::guessMonochrome(const QImage &img)
     if (img.width() >= 256 || m_theme->supportsIconColoring()) {
         return false;
     }
-    // round size to a standard size. hardcode as we can't use KIconLoader
-    int stdSize;
-    if (img.width() <= 16) {
-        stdSize = 16;
-    } else if (img.width() <= 22) {
-        stdSize = 22;
-    } else if (img.width() <= 24) {
-        stdSize = 24;
-    } else if (img.width() <= 32) {
-        stdSize = 32;
-    } else if (img.width() <= 48) {
-        stdSize = 48;
-    } else if (img.width() <= 64) {
-        stdSize = 64;
-    } else {
-        stdSize = 128;
-    }
 
-    auto findIt = m_monochromeHeuristics.constFind(stdSize);
-    if (findIt != m_monochromeHeuristics.constEnd()) {
-        return findIt.value();
-    }
-
-    QHash<int, int> dist;
-    int transparentPixels = 0;
-    int saturatedPixels = 0;
-    for(int x=0; x < img.width(); x++) {
-        for(int y=0; y < img.height(); y++) {
-            QColor color = QColor::fromRgba(qUnpremultiply(img.pixel(x, y)));
-            if (color.alpha() < 100) {
-                ++transparentPixels;
-                continue;
-            } else if (color.saturation() > 84) {
-                ++saturatedPixels;
-            }
-            dist[qGray(color.rgb())]++;
+    // Image providers may return anything for the same id, identify those by image
+    QString source;
+    if (m_source.type() == QVariant::String || m_source.type() == QVariant::Url) {
+        source = m_source.toString();
+        if (source.startsWith(QLatin1String("image://"))) {
+            source.clear();
         }
     }
-
-    QMultiMap<int, int> reverseDist;
-    auto it = dist.constBegin();
-    qreal entropy = 0;
-    while (it != dist.constEnd()) {
-        reverseDist.insert(it.value(), it.key());
-        qreal probability = qreal(it.value()) / qreal(img.size().width() * img.size().height() - transparentPixels);
-        entropy -= probability * log(probability) / log(255);
-        ++it;
-    }
-
-    // Arbitrarly low values of entropy and colored pixels
-    m_monochromeHeuristics[stdSize] = saturatedPixels <= (img.size().width()*img.size().height() - transparentPixels) * 0.3 && entropy <= 0.3;
-    return m_monochromeHeuristics[stdSize];
+    return IconCache::instance()->guessMonochrome(img, source, iconMode());
 }
 
 QString Icon::fallback() const
@@ -562,6 +707,22 @@ Icon::Status Icon::status() const
     return m_status;
 }
 
+bool Icon::asynchronous() const
+{
+    return m_asynchronous;
+}
+
+void Icon::setAsynchronous(bool asynchronous)
+{
+    if (asynchronous == m_asynchronous) {
+        return;
+    }
+
+    m_asynchronous = asynchronous;
+    polish();
+    Q_EMIT asynchronousChanged();
+}
+
 qreal Icon::paintedWidth() const
 {
     return m_paintedWidth;
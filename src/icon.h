@@ -13,6 +13,8 @@
 #include <QVariant>
 #include <QPointer>
 
+#include "iconcache.h"
+
 class QNetworkReply;
 
 namespace Kirigami {
@@ -145,6 +147,24 @@ class Icon : public QQuickItem
      * @since 5.15
      */
     Q_PROPERTY(qreal paintedHeight READ paintedHeight NOTIFY paintedAreaChanged)
+
+    /**
+     * Whether icons from the icon theme, files and resources are loaded
+     * in a worker thread instead of blocking the user interface.
+     *
+     * While loading, the `placeholder` icon is shown, or the previous image
+     * if there was one, and `status` is `Icon.Loading`. Icons of the
+     * same source and size being loaded at the same time are only loaded once.
+     *
+     * Icons drawn in the disabled, active or selected modes, and theme icons
+     * when the platform theme colors icons itself, are always loaded
+     * synchronously. Remote icons are always decoded in a worker thread,
+     * whatever the value of this property. The default is false.
+     *
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
 public:
     enum Status {
         Null = 0, /// No icon has been set
@@ -185,6 +205,9 @@ public:
     qreal paintedWidth() const;
     qreal paintedHeight() const;
 
+    bool asynchronous() const;
+    void setAsynchronous(bool asynchronous);
+
     QSGNode* updatePaintNode(QSGNode* node, UpdatePaintNodeData* data) override;
 
 Q_SIGNALS:
@@ -198,6 +221,7 @@ Q_SIGNALS:
     void placeholderChanged(const QString &placeholder);
     void statusChanged();
     void paintedAreaChanged();
+    void asynchronousChanged();
 
 protected:
     void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
@@ -205,6 +229,10 @@ protected:
     void handleFinished(QNetworkReply* reply);
     void handleRedirect(QNetworkReply* reply);
     QIcon::Mode iconMode() const;
+    bool isCacheable() const;
+    bool isRemote() const;
+    bool requestAsynchronously(const IconCacheKey &key, const QColor &tintColor);
+    void asyncImageReady(const IconCacheKey &key, const IconImage &image);
     bool guessMonochrome(const QImage &img);
     void setStatus(Status status);
     void updatePolish() override;
@@ -213,7 +241,6 @@ protected:
 private:
     Kirigami::PlatformTheme *m_theme = nullptr;
     QPointer<QNetworkReply> m_networkReply;
-    QHash<int, bool> m_monochromeHeuristics;
     QVariant m_source;
     Status m_status = Null;
     bool m_changed;
@@ -222,11 +249,21 @@ private:
     bool m_isMask;
     bool m_isMaskHeuristic = false;
     QImage m_loadedImage;
+    // The encoded remote image, until IconCache decoded it at the needed size
+    QByteArray m_remoteData;
+    bool m_downloaded = false;
     QColor m_color = Qt::transparent;
     QString m_fallback = QStringLiteral("unknown");
     QString m_placeholder = QStringLiteral("image-x-icon");
     qreal m_paintedWidth = 0.0;
     qreal m_paintedHeight = 0.0;
+    bool m_asynchronous = false;
+    // Whether m_icon is untinted and must be drawn in m_tintColor
+    bool m_tintInShader = false;
+    QColor m_tintColor;
+    // The icon being loaded asynchronously, or that failed to
+    IconCacheKey m_asyncKey;
+    bool m_asyncFailed = false;
 
     QImage m_icon;
 };
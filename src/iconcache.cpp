@@ -0,0 +1,629 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "iconcache.h"
+#include "libkirigami/platformtheme.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QGuiApplication>
+#include <QImageReader>
+#include <QPainter>
+#include <QQmlEngine>
+#include <QQuickWindow>
+#include <QSaveFile>
+#include <QSGRendererInterface>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// How long, in milliseconds, the platform theme may rasterize icons at once
+static const int s_platformPrefetchSlice = 4;
+
+uint qHash(const IconCacheKey &key, uint seed)
+{
+    seed = qHash(key.source, seed);
+    seed = qHash(key.size.width(), seed) ^ qHash(key.size.height(), seed << 1);
+    seed = qHash(qRound(key.devicePixelRatio * 100), seed);
+    seed = qHash(int(key.mode), seed);
+    seed = qHash(key.tint, seed);
+    seed = qHash(int(key.mask), seed);
+    seed = qHash(int(key.plainImage), seed);
+    seed = qHash(key.platformColor, seed);
+    seed = qHash(key.platformColorSet, seed);
+    seed = qHash(key.platformTextColor, seed);
+    return qHash(key.themeName, seed);
+}
+
+namespace {
+
+/**
+ * A minimal implementation of the freedesktop icon theme lookup, for the
+ * worker threads, which can't use QIcon::fromTheme.
+ */
+struct ThemeDirectory
+{
+    QString path;
+    int size = 0;
+    int minSize = 0;
+    int maxSize = 0;
+};
+
+struct Theme
+{
+    QStringList baseDirectories;
+    QVector<ThemeDirectory> directories;
+    QStringList parents;
+};
+
+QMutex s_themesMutex;
+QHash<QString, Theme> s_themes;
+
+Theme loadTheme(const QString &name, const QStringList &searchPaths)
+{
+    QMutexLocker locker(&s_themesMutex);
+    auto it = s_themes.constFind(name);
+    if (it != s_themes.constEnd()) {
+        return *it;
+    }
+
+    Theme theme;
+    for (const QString &searchPath : searchPaths) {
+        const QString base = searchPath + QLatin1Char('/') + name;
+        if (!QFileInfo::exists(base)) {
+            continue;
+        }
+        theme.baseDirectories << base;
+        if (!theme.directories.isEmpty() || !QFileInfo::exists(base + QStringLiteral("/index.theme"))) {
+            continue;
+        }
+
+        QSettings index(base + QStringLiteral("/index.theme"), QSettings::IniFormat);
+        theme.parents = index.value(QStringLiteral("Icon Theme/Inherits")).toStringList();
+        const QStringList directories = index.value(QStringLiteral("Icon Theme/Directories")).toStringList()
+            + index.value(QStringLiteral("Icon Theme/ScaledDirectories")).toStringList();
+        for (const QString &directory : directories) {
+            index.beginGroup(directory);
+            ThemeDirectory entry;
+            entry.path = directory;
+            entry.size = index.value(QStringLiteral("Size")).toInt();
+            const QString type = index.value(QStringLiteral("Type"), QStringLiteral("Threshold")).toString();
+            if (type == QLatin1String("Scalable")) {
+                entry.minSize = index.value(QStringLiteral("MinSize"), entry.size).toInt();
+                entry.maxSize = index.value(QStringLiteral("MaxSize"), entry.size).toInt();
+            } else if (type == QLatin1String("Threshold")) {
+                const int threshold = index.value(QStringLiteral("Threshold"), 2).toInt();
+                entry.minSize = entry.size - threshold;
+                entry.maxSize = entry.size + threshold;
+            } else {
+                entry.minSize = entry.maxSize = entry.size;
+            }
+            // Scaled directories are for other device pixel ratios
+            if (index.value(QStringLiteral("Scale"), 1).toInt() == 1 && entry.size > 0) {
+                theme.directories << entry;
+            }
+            index.endGroup();
+        }
+    }
+
+    s_themes.insert(name, theme);
+    return theme;
+}
+
+QString findInTheme(const QString &iconName, int size, const QString &themeName, const QStringList &searchPaths, QStringList &visited)
+{
+    if (visited.contains(themeName)) {
+        return QString();
+    }
+    visited << themeName;
+
+    static const QStringList extensions = {QStringLiteral(".svg"), QStringLiteral(".svgz"), QStringLiteral(".png")};
+
+    const Theme theme = loadTheme(themeName, searchPaths);
+    QString closest;
+    int closestDistance = INT_MAX;
+    for (const ThemeDirectory &directory : theme.directories) {
+        const int distance = size < directory.minSize ? directory.minSize - size : (size > directory.maxSize ? size - directory.maxSize : 0);
+        if (distance >= closestDistance) {
+            continue;
+        }
+        for (const QString &base : theme.baseDirectories) {
+            for (const QString &extension : extensions) {
+                const QString path = base + QLatin1Char('/') + directory.path + QLatin1Char('/') + iconName + extension;
+                if (QFileInfo::exists(path)) {
+                    if (distance == 0) {
+                        return path;
+                    }
+                    closest = path;
+                    closestDistance = distance;
+                    break;
+                }
+            }
+        }
+    }
+    if (!closest.isEmpty()) {
+        return closest;
+    }
+
+    for (const QString &parent : theme.parents) {
+        const QString path = findInTheme(iconName, size, parent, searchPaths, visited);
+        if (!path.isEmpty()) {
+            return path;
+        }
+    }
+    return QString();
+}
+
+QString findThemeIcon(const QString &iconName, int size, const QString &themeName, const QStringList &searchPaths)
+{
+    QStringList visited;
+    QString path = findInTheme(iconName, size, themeName, searchPaths, visited);
+    if (path.isEmpty()) {
+        path = findInTheme(iconName, size, QStringLiteral("hicolor"), searchPaths, visited);
+    }
+    return path;
+}
+
+}
+
+IconCache::IconCache(QObject *parent)
+    : QObject(parent)
+    , m_images(QStringLiteral("IconCache"), 10240)
+{
+    // A guess is a few bytes, this is bound by the number of different icons
+    m_monochrome.setMaxCost(4096);
+    // Leave room for the other users of the global pool, such as ImageColors
+    m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+
+    // Every slice lets the events in between be processed
+    m_platformPrefetchTimer.setInterval(0);
+    connect(&m_platformPrefetchTimer, &QTimer::timeout, this, &IconCache::processPlatformPrefetchQueue);
+}
+
+IconCache *IconCache::instance()
+{
+    // Never deleted, like CacheManager
+    static IconCache *s_instance = new IconCache;
+    return s_instance;
+}
+
+int IconCache::maximumCost() const
+{
+    return m_images.maximumCost();
+}
+
+void IconCache::setMaximumCost(int maximumCost)
+{
+    maximumCost = qMax(0, maximumCost);
+    if (maximumCost == m_images.maximumCost()) {
+        return;
+    }
+
+    m_images.setMaximumCost(maximumCost);
+    Q_EMIT maximumCostChanged();
+}
+
+bool IconCache::persistentThumbnails() const
+{
+    return m_persistentThumbnails;
+}
+
+void IconCache::setPersistentThumbnails(bool persistent)
+{
+    if (persistent == m_persistentThumbnails) {
+        return;
+    }
+
+    m_persistentThumbnails = persistent;
+    Q_EMIT persistentThumbnailsChanged();
+}
+
+QString IconCache::thumbnailPath(const IconCacheKey &key, bool highDpiPixmaps) const
+{
+    if (!m_persistentThumbnails) {
+        return QString();
+    }
+
+    const QSize size = key.size * (highDpiPixmaps ? key.devicePixelRatio : 1.0);
+    const QByteArray id = key.source.toUtf8() + '@' + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + QStringLiteral("/kirigami/icons/")
+        + QString::fromLatin1(QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex())
+        + QStringLiteral(".png");
+}
+
+QImage IconCache::loadThumbnail(const IconCacheKey &key, bool highDpiPixmaps) const
+{
+    const QString path = thumbnailPath(key, highDpiPixmaps);
+    if (path.isEmpty() || !QFileInfo::exists(path)) {
+        return QImage();
+    }
+
+    QImage image(path);
+    if (!image.isNull()) {
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(highDpiPixmaps ? key.devicePixelRatio : 1.0);
+    }
+    return image;
+}
+
+void IconCache::setPlatformColors(IconCacheKey &key, Kirigami::PlatformTheme *theme, const QColor &color)
+{
+    if (!theme->supportsIconColoring() || key.source.contains(QLatin1String("/"))) {
+        return;
+    }
+
+    key.platformColor = color.rgba();
+    key.platformColorSet = theme->colorSet();
+    key.platformTextColor = theme->textColor().rgba();
+}
+
+IconImage IconCache::find(const IconCacheKey &key)
+{
+    const IconImage image = m_images.find(key);
+    if (image.image.isNull()) {
+        ++m_misses;
+    } else {
+        ++m_hits;
+    }
+    return image;
+}
+
+void IconCache::insert(const IconCacheKey &key, const IconImage &image)
+{
+    if (image.image.isNull()) {
+        return;
+    }
+
+    m_images.insert(key, image);
+    CacheManager::instance()->cacheChanged(&m_images);
+}
+
+IconImage IconCache::loadImage(const IconRequest &request)
+{
+    const IconImage image = rasterize(request);
+    if (!request.key.plainImage) {
+        insert(request.key, image);
+    }
+    return image;
+}
+
+void IconCache::requestImage(const IconRequest &request, QObject *receiver, const std::function<void(const IconImage &)> &callback)
+{
+    if (receiver) {
+        auto &receivers = m_receivers[request.key];
+        auto it = std::find_if(receivers.begin(), receivers.end(), [receiver](const Receiver &r) {
+            return r.object == receiver;
+        });
+        if (it != receivers.end()) {
+            it->callback = callback;
+        } else {
+            receivers.append({receiver, callback});
+        }
+    }
+
+    if (m_pending.contains(request.key)) {
+        return;
+    }
+
+    auto watcher = new QFutureWatcher<IconImage>(this);
+    m_pending.insert(request.key, watcher);
+    const IconCacheKey key = request.key;
+    connect(watcher, &QFutureWatcher<IconImage>::finished, this, [this, watcher, key]() {
+        m_pending.remove(key);
+        watcher->deleteLater();
+
+        const IconImage image = watcher->result();
+        if (!image.image.isNull() && !key.plainImage) {
+            insert(key, image);
+        }
+        const auto receivers = m_receivers.take(key);
+        for (const Receiver &receiver : receivers) {
+            if (receiver.object) {
+                receiver.callback(image);
+            }
+        }
+        processPrefetchQueue();
+    });
+    watcher->setFuture(QtConcurrent::run(&m_threadPool, [request]() {
+        return rasterize(request);
+    }));
+}
+
+void IconCache::prefetch(const QStringList &names, const QVariantList &sizes, QQuickWindow *window)
+{
+    auto theme = static_cast<Kirigami::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::PlatformTheme>(this, true));
+    const bool highDpiPixmaps = QCoreApplication::instance()->testAttribute(Qt::AA_UseHighDpiPixmaps);
+    if (!window) {
+        const auto windows = qGuiApp->topLevelWindows();
+        for (auto topLevel : windows) {
+            if ((window = qobject_cast<QQuickWindow *>(topLevel))) {
+                break;
+            }
+        }
+    }
+    // Like Icon
+    const qreal devicePixelRatio = window ? window->devicePixelRatio() : qGuiApp->devicePixelRatio();
+    // Like Icon: tinted by a shader unless rendering in software
+    const bool software = window ? window->rendererInterface()->graphicsApi() == QSGRendererInterface::Software
+        : QQuickWindow::sceneGraphBackend() == QLatin1String("software")
+            || qEnvironmentVariable("QT_QUICK_BACKEND") == QLatin1String("software");
+
+    for (const QString &name : names) {
+        IconRequest request;
+        request.source = name;
+        if (request.source.startsWith(QLatin1String("qrc:/"))) {
+            request.source = request.source.mid(3);
+        } else if (request.source.startsWith(QLatin1String("file:/"))) {
+            request.source = QUrl(request.source).path();
+        }
+        request.themeIcon = !request.source.contains(QLatin1String("/"));
+        if (name.isEmpty()) {
+            continue;
+        }
+        // Such icons are loaded by the platform theme, in the GUI thread
+        const bool platformIcon = request.themeIcon && theme->supportsIconColoring();
+        request.themeSearchPaths = QIcon::themeSearchPaths();
+        request.tint = software ? theme->textColor() : QColor();
+        request.tintMonochrome = !theme->supportsIconColoring();
+        request.highDpiPixmaps = highDpiPixmaps;
+
+        request.key.source = name;
+        request.key.devicePixelRatio = devicePixelRatio;
+        request.key.tint = software ? theme->textColor().rgba() : 0;
+        request.key.mask = name.endsWith(QLatin1String("-symbolic"))
+            || name.endsWith(QLatin1String("-symbolic-rtl"))
+            || name.endsWith(QLatin1String("-symbolic-ltr"));
+        request.key.themeName = QIcon::themeName();
+        // Icons are transparent by default
+        setPlatformColors(request.key, theme, Qt::transparent);
+
+        for (const QVariant &size : sizes) {
+            const int side = qRound(size.toReal() * (highDpiPixmaps ? 1.0 : devicePixelRatio));
+            if (side <= 0) {
+                continue;
+            }
+            request.key.size = QSize(side, side);
+            if (m_images.contains(request.key) || m_pending.contains(request.key)) {
+                continue;
+            }
+            if (platformIcon) {
+                m_platformPrefetchQueue << PlatformPrefetch{request.key, window, request.tint};
+            } else {
+                m_prefetchQueue << request;
+            }
+        }
+    }
+
+    processPrefetchQueue();
+    if (!m_platformPrefetchQueue.isEmpty()) {
+        m_platformPrefetchTimer.start();
+    }
+}
+
+void IconCache::processPrefetchQueue()
+{
+    // Keep the pool's queue short, for the icons that are needed right away
+    while (!m_prefetchQueue.isEmpty() && m_pending.count() < m_threadPool.maxThreadCount()) {
+        const IconRequest request = m_prefetchQueue.takeFirst();
+        if (!m_images.contains(request.key)) {
+            requestImage(request);
+        }
+    }
+}
+
+void IconCache::cancelRequest(const IconCacheKey &key, QObject *receiver)
+{
+    auto it = m_receivers.find(key);
+    if (it == m_receivers.end()) {
+        return;
+    }
+
+    it->erase(std::remove_if(it->begin(), it->end(), [receiver](const Receiver &r) {
+        return r.object == receiver || !r.object;
+    }), it->end());
+    if (it->isEmpty()) {
+        m_receivers.erase(it);
+    }
+}
+
+void IconCache::processPlatformPrefetchQueue()
+{
+    auto theme = static_cast<Kirigami::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::PlatformTheme>(this, true));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_platformPrefetchQueue.isEmpty() && timer.elapsed() < s_platformPrefetchSlice) {
+        const PlatformPrefetch prefetch = m_platformPrefetchQueue.takeFirst();
+        if (m_images.contains(prefetch.key)) {
+            continue;
+        }
+
+        // Like Icon::findIcon()
+        const QIcon icon = theme->iconFromTheme(prefetch.key.source, Qt::transparent);
+        IconImage image;
+        image.image = icon.pixmap(prefetch.window, prefetch.key.size, prefetch.key.mode, QIcon::On).toImage();
+        // Icon doesn't guess whether icons colored by the platform are monochrome
+        image.tintable = prefetch.key.mask;
+        if (image.tintable && prefetch.tint.isValid() && prefetch.tint.alpha() > 0) {
+            QPainter p(&image.image);
+            p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+            p.fillRect(image.image.rect(), prefetch.tint);
+            p.end();
+        }
+        insert(prefetch.key, image);
+    }
+
+    if (m_platformPrefetchQueue.isEmpty()) {
+        m_platformPrefetchTimer.stop();
+    }
+}
+
+bool IconCache::isPending(const IconCacheKey &key) const
+{
+    return m_pending.contains(key);
+}
+
+IconImage IconCache::rasterize(const IconRequest &request)
+{
+    const qreal dpr = request.highDpiPixmaps ? request.key.devicePixelRatio : 1.0;
+    const QSize size = request.key.size * dpr;
+
+    QBuffer buffer;
+    QImageReader reader;
+    QString path = request.source;
+    if (!request.data.isEmpty()) {
+        buffer.setData(request.data);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+    } else {
+        if (request.themeIcon) {
+            path = findThemeIcon(request.source, request.key.size.width(), request.key.themeName, request.themeSearchPaths);
+        }
+        if (path.isEmpty()) {
+            return IconImage();
+        }
+        reader.setFileName(path);
+    }
+
+    // Decode right at the needed size, so that the full size image is never held
+    // A dimension missing from the size follows the aspect ratio, and images
+    // without size are decoded at their own size
+    const QSize sourceSize = reader.size();
+    if (sourceSize.isValid() && (size.width() > 0 || size.height() > 0)) {
+        const QSize bounds(size.width() > 0 ? size.width() : INT_MAX, size.height() > 0 ? size.height() : INT_MAX);
+        QSize targetSize = sourceSize.scaled(bounds, Qt::KeepAspectRatio);
+        // Like QIcon::pixmap, don't scale raster image files up
+        if (request.data.isEmpty() && !path.endsWith(QLatin1String(".svg")) && !path.endsWith(QLatin1String(".svgz"))
+            && sourceSize.width() <= bounds.width() && sourceSize.height() <= bounds.height()) {
+            targetSize = sourceSize;
+        }
+        reader.setScaledSize(targetSize);
+    }
+
+    IconImage result;
+    result.image = reader.read();
+    if (result.image.isNull()) {
+        return result;
+    }
+    result.image = result.image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    result.image.setDevicePixelRatio(dpr);
+
+    if (!request.thumbnailPath.isEmpty()) {
+        QDir().mkpath(QFileInfo(request.thumbnailPath).path());
+        // Written atomically, as icons of other windows may be loading it already
+        QSaveFile file(request.thumbnailPath);
+        if (!file.open(QIODevice::WriteOnly) || !result.image.save(&file, "PNG") || !file.commit()) {
+            qWarning() << "Could not save icon thumbnail" << request.thumbnailPath;
+        }
+    }
+
+    result.tintable = request.key.mask || (request.tintMonochrome && result.image.width() < 256 && instance()->guessMonochrome(result.image, request.key.source, request.key.mode));
+    if (result.tintable && request.tint.isValid() && request.tint.alpha() > 0) {
+        QPainter p(&result.image);
+        p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        p.fillRect(result.image.rect(), request.tint);
+        p.end();
+    }
+    return result;
+}
+
+bool IconCache::guessMonochrome(const QImage &image, const QString &source, QIcon::Mode mode)
+{
+    // Icons loaded from the same source are the same, whatever QImage they end up in
+    const QString key = source.isEmpty()
+        ? QStringLiteral("#%1").arg(image.cacheKey())
+        : QStringLiteral("%1:%2x%3:%4").arg(int(mode)).arg(image.width()).arg(image.height()).arg(source);
+
+    {
+        QMutexLocker locker(&m_monochromeMutex);
+        if (bool *cached = m_monochrome.object(key)) {
+            ++m_monochromeHits;
+            return *cached;
+        }
+    }
+
+    // Analyze outside of the lock, at worst two threads do it at once
+    const bool monochrome = isMonochrome(image);
+
+    QMutexLocker locker(&m_monochromeMutex);
+    m_monochrome.insert(key, new bool(monochrome));
+    return monochrome;
+}
+
+bool IconCache::isMonochrome(const QImage &img)
+{
+    const QImage image = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    int histogram[256] = {};
+    int transparentPixels = 0;
+    int saturatedPixels = 0;
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const QRgb premultiplied = line[x];
+            if (qAlpha(premultiplied) < 100) {
+                ++transparentPixels;
+                continue;
+            }
+
+            const QRgb pixel = qUnpremultiply(premultiplied);
+            const int r = qRed(pixel);
+            const int g = qGreen(pixel);
+            const int b = qBlue(pixel);
+            // Same as QColor::saturation() > 84, that is a HSV saturation over a third
+            const int max = qMax(r, qMax(g, b));
+            const int delta = max - qMin(r, qMin(g, b));
+            if (max > 0 && (delta * 65535 * 2 + max) / (2 * max) >= 85 * 256) {
+                ++saturatedPixels;
+            }
+            ++histogram[qGray(r, g, b)];
+        }
+    }
+
+    const int opaquePixels = image.width() * image.height() - transparentPixels;
+    qreal entropy = 0;
+    for (int count : histogram) {
+        if (count > 0) {
+            const qreal probability = qreal(count) / qreal(opaquePixels);
+            entropy -= probability * log(probability) / log(255);
+        }
+    }
+
+    // Arbitrarly low values of entropy and colored pixels
+    return saturatedPixels <= opaquePixels * 0.3 && entropy <= 0.3;
+}
+
+QVariantMap IconCache::statistics() const
+{
+    QMutexLocker locker(&m_monochromeMutex);
+    return {
+        {QStringLiteral("hits"), m_hits},
+        {QStringLiteral("misses"), m_misses},
+        {QStringLiteral("count"), m_images.count()},
+        {QStringLiteral("cost"), m_images.totalCost()},
+        {QStringLiteral("maximumCost"), m_images.maximumCost()},
+        {QStringLiteral("monochromeHits"), m_monochromeHits},
+        {QStringLiteral("monochromeCount"), m_monochrome.count()},
+    };
+}
+
+void IconCache::clear()
+{
+    m_images.clear();
+}
@@ -0,0 +1,293 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QCache>
+#include <QColor>
+#include <QIcon>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariant>
+
+#include <functional>
+
+#include "managedimagecache.h"
+
+/**
+ * Everything that affects how an Icon with a given source is rasterized.
+ */
+struct IconCacheKey
+{
+    QString source;
+    QSize size;
+    qreal devicePixelRatio = 1.0;
+    QIcon::Mode mode = QIcon::Normal;
+    /// 0 when the image is not tinted, or tinted by the renderer
+    QRgb tint = 0;
+    bool mask = false;
+    QString themeName;
+    /// Only for the icons the platform theme recolors, see IconCache::setPlatformColors():
+    /// the requested color, and the color set and text color of the theme
+    QRgb platformColor = 0;
+    int platformColorSet = -1;
+    QRgb platformTextColor = 0;
+    /// Whether the source is decoded as a plain image, as ShadowedImage does, which is never tinted.
+    /// IconCache doesn't keep such images, which may be large photos, see requestImage()
+    bool plainImage = false;
+
+    bool operator==(const IconCacheKey &other) const
+    {
+        return source == other.source
+            && size == other.size
+            && qFuzzyCompare(devicePixelRatio, other.devicePixelRatio)
+            && mode == other.mode
+            && tint == other.tint
+            && mask == other.mask
+            && themeName == other.themeName
+            && platformColor == other.platformColor
+            && platformColorSet == other.platformColorSet
+            && platformTextColor == other.platformTextColor
+            && plainImage == other.plainImage;
+    }
+};
+
+uint qHash(const IconCacheKey &key, uint seed = 0);
+
+template<typename T> class QFutureWatcher;
+class QQuickWindow;
+
+namespace Kirigami {
+class PlatformTheme;
+}
+
+/**
+ * A rasterized icon.
+ */
+struct IconImage
+{
+    QImage image;
+    /// Whether the icon is a mask or monochrome, so can be drawn in any color
+    bool tintable = false;
+};
+
+/**
+ * What a worker thread needs to rasterize an icon without touching
+ * QIcon or QPixmap, which are bound to the GUI thread.
+ */
+struct IconRequest
+{
+    IconCacheKey key;
+    /// A file or resource path, or the name of an icon in the icon theme
+    QString source;
+    bool themeIcon = false;
+    QStringList themeSearchPaths;
+    /// If valid, tintable icons are tinted right away, otherwise this is left to the renderer
+    QColor tint;
+    /// Whether icons detected as monochrome get tinted too, not only masks
+    bool tintMonochrome = true;
+    /// Whether key.size is in device independent pixels
+    bool highDpiPixmaps = false;
+    /// The downloaded image of a remote source, decoded instead of looking up source
+    QByteArray data;
+    /// If not empty, where to save the decoded image of a remote source
+    QString thumbnailPath;
+};
+
+/**
+ * A process wide cache of rasterized icons.
+ *
+ * Icons with the same source, size, mode and colors share the very same
+ * QImage, so that ImageTexturesCache, which works by QImage::cacheKey(),
+ * can share their textures too.
+ *
+ * The least recently used images are dropped once the images take more
+ * than maximumCost kilobytes.
+ *
+ * @since 5.78
+ * @since org.kde.kirigami 2.15
+ */
+class IconCache : public QObject
+{
+    Q_OBJECT
+
+    /**
+     * How much memory, in kilobytes, the cached images can take.
+     * Defaults to 10240.
+     */
+    Q_PROPERTY(int maximumCost READ maximumCost WRITE setMaximumCost NOTIFY maximumCostChanged)
+
+    /**
+     * Whether remote icons, once decoded at the size they are shown at,
+     * are also saved in the cache directory of the application, so that
+     * they don't need to be downloaded and decoded again in the next runs.
+     * Defaults to false.
+     */
+    Q_PROPERTY(bool persistentThumbnails READ persistentThumbnails WRITE setPersistentThumbnails NOTIFY persistentThumbnailsChanged)
+
+public:
+    static IconCache *instance();
+
+    int maximumCost() const;
+    void setMaximumCost(int maximumCost);
+
+    bool persistentThumbnails() const;
+    void setPersistentThumbnails(bool persistent);
+
+    /**
+     * @returns where the thumbnail of the remote icon of @p key is saved,
+     * or an empty string if persistentThumbnails is false.
+     */
+    QString thumbnailPath(const IconCacheKey &key, bool highDpiPixmaps) const;
+
+    /**
+     * @returns the thumbnail of the remote icon of @p key saved in a
+     * previous run, or a null image.
+     */
+    QImage loadThumbnail(const IconCacheKey &key, bool highDpiPixmaps) const;
+
+    /**
+     * Adds to @p key what the icon depends on when @p theme rasterizes it
+     * itself, that is for icon theme names when the theme supports icon
+     * coloring: the theme may recolor them in @p color, or in its own colors.
+     */
+    static void setPlatformColors(IconCacheKey &key, Kirigami::PlatformTheme *theme, const QColor &color);
+
+    /**
+     * @returns the cached image for @p key, or a null image.
+     */
+    IconImage find(const IconCacheKey &key);
+    void insert(const IconCacheKey &key, const IconImage &image);
+
+    /**
+     * Rasterizes an icon right away, in the calling thread, and caches it
+     * unless its key is a plainImage one.
+     */
+    IconImage loadImage(const IconRequest &request);
+
+    /**
+     * Rasterizes an icon in a worker thread and caches it.
+     *
+     * Once done, @p callback is called in the GUI thread with the image, or
+     * with a null image if it failed, unless @p receiver got destroyed or
+     * cancelled the request in the meantime. The image is handed over this
+     * way even if it isn't cached, such as the ones of plainImage keys or
+     * the ones larger than maximumCost.
+     *
+     * Requesting a key that is already being rasterized doesn't start a
+     * second job, the receiver is notified by the running one.
+     * @p receiver may be null, to only fill the cache.
+     */
+    void requestImage(const IconRequest &request, QObject *receiver = nullptr, const std::function<void(const IconImage &)> &callback = {});
+
+    /**
+     * Stops notifying @p receiver about the image of @p key. The image is
+     * still rasterized and cached.
+     */
+    void cancelRequest(const IconCacheKey &key, QObject *receiver);
+    bool isPending(const IconCacheKey &key) const;
+
+    /**
+     * @returns whether @p image looks monochrome, and can thus be tinted.
+     *
+     * The answer is remembered for @p source in @p mode at the size of the
+     * image, or for the image itself when @p source is empty.
+     * Safe to call from any thread.
+     */
+    bool guessMonochrome(const QImage &image, const QString &source = QString(), QIcon::Mode mode = QIcon::Normal);
+
+    /**
+     * The uncached analysis behind guessMonochrome().
+     */
+    static bool isMonochrome(const QImage &image);
+
+    /**
+     * Loads icons ahead of time, so that the Icons showing them later find
+     * them in the cache, for instance the icons of the first pages of an
+     * application during startup:
+     *
+     * @code{.qml}
+     * Component.onCompleted: Kirigami.IconCache.prefetch(
+     *     ["document-new", "document-open", "edit-delete"],
+     *     [Kirigami.Units.iconSizes.small, Kirigami.Units.iconSizes.medium])
+     * @endcode
+     *
+     * Every icon is loaded at every size, with the default colors of the
+     * platform theme, in the worker threads used by asynchronous Icons.
+     * Prefetched icons only use a few threads at once, so icons that are
+     * visible right away don't wait behind them.
+     *
+     * When the platform theme colors icons itself, as on Plasma, the icons
+     * of the icon theme can only be loaded by it, in the GUI thread: they
+     * are then loaded a few at a time, in between events. They are only
+     * found by Icons using the default color set and colors.
+     *
+     * @param names icon theme names, or paths and urls of local files and resources
+     * @param sizes the sizes, in device independent pixels, of square icons
+     * @param window the window the icons are shown in, for its device pixel
+     * ratio, by default the first window of the application
+     */
+    Q_INVOKABLE void prefetch(const QStringList &names, const QVariantList &sizes, QQuickWindow *window = nullptr);
+
+    /**
+     * @returns a map with the keys `hits`, `misses`, `count`,
+     * `cost` and `maximumCost`, costs being in kilobytes, as well as
+     * `monochromeHits` and `monochromeCount` for guessMonochrome().
+     */
+    Q_INVOKABLE QVariantMap statistics() const;
+
+    /**
+     * Drops all the cached images. Icons keep showing their current image.
+     *
+     * Monochrome guesses are kept, as they don't depend on the icon theme.
+     */
+    Q_INVOKABLE void clear();
+
+Q_SIGNALS:
+    void maximumCostChanged();
+    void persistentThumbnailsChanged();
+
+private:
+    explicit IconCache(QObject *parent = nullptr);
+
+    static IconImage rasterize(const IconRequest &request);
+    void processPrefetchQueue();
+    void processPlatformPrefetchQueue();
+
+    QThreadPool m_threadPool;
+    QHash<IconCacheKey, QFutureWatcher<IconImage> *> m_pending;
+    // Only the receivers waiting for a key are notified, not every Icon
+    struct Receiver {
+        QPointer<QObject> object;
+        std::function<void(const IconImage &)> callback;
+    };
+    QHash<IconCacheKey, QVector<Receiver>> m_receivers;
+    QList<IconRequest> m_prefetchQueue;
+    // Icons rasterized by the platform theme, in the GUI thread
+    struct PlatformPrefetch {
+        IconCacheKey key;
+        QPointer<QQuickWindow> window;
+        QColor tint;
+    };
+    QList<PlatformPrefetch> m_platformPrefetchQueue;
+    QTimer m_platformPrefetchTimer;
+
+    // Registered with CacheManager as "IconCache"
+    ManagedImageCache<IconCacheKey, IconImage> m_images;
+    int m_hits = 0;
+    int m_misses = 0;
+    bool m_persistentThumbnails = false;
+
+    // Guarded by m_monochromeMutex, as workers use it too
+    mutable QMutex m_monochromeMutex;
+    QCache<QString, bool> m_monochrome;
+    int m_monochromeHits = 0;
+};
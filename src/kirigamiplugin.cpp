@@ -19,14 +19,19 @@
 #include "wheelhandler.h"
 #include "shadowedrectangle.h"
 #include "shadowedtexture.h"
+#include "shadowedimage.h"
 #include "colorutils.h"
 #include "pagerouter.h"
 #include "imagecolors.h"
 #include "avatar.h"
 #include "toolbarlayout.h"
 #include "sizegroup.h"
+#include "cachemanager.h"
+#include "iconcache.h"
+#include "shaderquality.h"
 
 #include <QQmlContext>
+#include <QQmlEngine>
 #include <QQuickItem>
 #include <QQuickStyle>
 #include <QGuiApplication>
@@ -245,7 +250,7 @@ void KirigamiPlugin::registerTypes(const char *uri)
     // 2.12
     qmlRegisterType<ShadowedRectangle>(uri, 2, 12, "ShadowedRectangle");
     qmlRegisterType<ShadowedTexture>(uri, 2, 12, "ShadowedTexture");
-    qmlRegisterType(componentUrl(QStringLiteral("ShadowedImage.qml")), uri, 2, 12, "ShadowedImage");
+    qmlRegisterType<ShadowedImage>(uri, 2, 12, "ShadowedImage");
     qmlRegisterType(componentUrl(QStringLiteral("PlaceholderMessage.qml")), uri, 2, 12, "PlaceholderMessage");
 
     qmlRegisterUncreatableType<BorderGroup>(uri, 2, 12, "BorderGroup", QStringLiteral("Used as grouped property"));
@@ -271,6 +276,21 @@ void KirigamiPlugin::registerTypes(const char *uri)
     qmlRegisterSingletonType<DisplayHint>(uri, 2, 14, "DisplayHint", [](QQmlEngine*, QJSEngine*) -> QObject* { return new DisplayHint; });
     qmlRegisterType<SizeGroup>(uri, 2, 14, "SizeGroup");
 
+    // 2.15
+    qmlRegisterUncreatableType<PagePoolAttached>(uri, 2, 15, "PagePoolAttached", QStringLiteral("PagePoolAttached cannot be created"));
+    qmlRegisterSingletonType<CacheManager>(uri, 2, 15, "CacheManager", [](QQmlEngine*, QJSEngine*) -> QObject* {
+        auto manager = CacheManager::instance();
+        // Shared by every engine of the process
+        QQmlEngine::setObjectOwnership(manager, QQmlEngine::CppOwnership);
+        return manager;
+    });
+    qmlRegisterSingletonType<IconCache>(uri, 2, 15, "IconCache", [](QQmlEngine*, QJSEngine*) -> QObject* {
+        auto cache = IconCache::instance();
+        QQmlEngine::setObjectOwnership(cache, QQmlEngine::CppOwnership);
+        return cache;
+    });
+    qmlRegisterUncreatableType<ShaderQuality>(uri, 2, 15, "ShaderQuality", QStringLiteral("Cannot create objects of type ShaderQuality, use it as an attached property"));
+
     qmlProtectModule(uri, 2);
 }
 
@@ -0,0 +1,158 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+
+#include "cachemanager.h"
+
+/**
+ * A ManagedCache of images, or of values holding an image in an `image`
+ * member, such as IconImage.
+ *
+ * The least recently used images are dropped once they take more than
+ * maximumCost kilobytes. The cache may be used from any thread, such as the
+ * render threads of the windows, but it registers itself with CacheManager,
+ * which is not thread safe, so it must be created in the GUI thread.
+ */
+template<typename Key, typename Value = QImage>
+class ManagedImageCache : public ManagedCache
+{
+public:
+    ManagedImageCache(const QString &name, int maximumCost)
+        : m_name(name)
+    {
+        m_images.setMaxCost(maximumCost);
+        CacheManager::instance()->registerCache(this);
+    }
+
+    ~ManagedImageCache() override
+    {
+        CacheManager::instance()->unregisterCache(this);
+    }
+
+    /**
+     * @returns the value of @p key, or a default constructed one.
+     */
+    Value find(const Key &key)
+    {
+        QMutexLocker locker(&m_mutex);
+        Value *value = m_images.object(key);
+        return value ? *value : Value();
+    }
+
+    bool contains(const Key &key) const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_images.contains(key);
+    }
+
+    /**
+     * Callers in the GUI thread should let CacheManager know with
+     * CacheManager::cacheChanged() afterwards.
+     */
+    void insert(const Key &key, const Value &value)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_images.insert(key, new Value(value), imageCost(imageOf(value)));
+    }
+
+    bool remove(const Key &key)
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_images.remove(key);
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_images.clear();
+    }
+
+    int count() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_images.count();
+    }
+
+    // In kilobytes
+    int totalCost() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_images.totalCost();
+    }
+
+    int maximumCost() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_images.maxCost();
+    }
+
+    void setMaximumCost(int maximumCost)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_images.setMaxCost(maximumCost);
+    }
+
+    QString cacheName() const override
+    {
+        return m_name;
+    }
+
+    int cachePriority() const override
+    {
+        // Images are quick to render again
+        return 5;
+    }
+
+    qint64 cacheCost() const override
+    {
+        return qint64(totalCost()) * 1024;
+    }
+
+    int cacheCount() const override
+    {
+        return count();
+    }
+
+    void trimCache(qint64 maximumCost) override
+    {
+        QMutexLocker locker(&m_mutex);
+        if (qint64(m_images.totalCost()) * 1024 <= maximumCost) {
+            return;
+        }
+
+        // QCache trims from the least recently used when its maximum shrinks
+        const int maxCost = m_images.maxCost();
+        m_images.setMaxCost(int(maximumCost / 1024));
+        m_images.setMaxCost(maxCost);
+    }
+
+    // In kilobytes, but never 0 so that the count is bounded too
+    static int imageCost(const QImage &image)
+    {
+        return qMax<int>(1, image.sizeInBytes() / 1024);
+    }
+
+private:
+    static const QImage &imageOf(const QImage &image)
+    {
+        return image;
+    }
+
+    template<typename T>
+    static const QImage &imageOf(const T &value)
+    {
+        return value.image;
+    }
+
+    QString m_name;
+    mutable QMutex m_mutex;
+    QCache<Key, Value> m_images;
+};
@@ -5,20 +5,128 @@
  */
 
 #include "pagepool.h"
+#include "cachemanager.h"
 
+#include <QDataStream>
 #include <QDebug>
 #include <QQmlEngine>
 #include <QQmlComponent>
 #include <QQmlContext>
+#include <QQmlIncubator>
 #include <QQmlProperty>
+#include <QSet>
+#include <QTimer>
+
+#include <functional>
+#include <limits>
+
+// Writes value as a cache key, without losing anything that tells values apart
+static void writeKeyValue(QDataStream &stream, const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        stream << quint32(list.count());
+        for (const QVariant &item : list) {
+            writeKeyValue(stream, item);
+        }
+        return;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        stream << quint32(map.count());
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            stream << it.key();
+            writeKeyValue(stream, it.value());
+        }
+        return;
+    }
+    default:
+        break;
+    }
+
+    stream << QByteArray(value.typeName());
+    if (QObject *object = value.value<QObject *>()) {
+        // Objects are identified by their address
+        stream << quint64(quintptr(object));
+    } else if (value.userType() < QMetaType::User) {
+        stream << value;
+    } else {
+        // Types without stream operators, told apart by comparing them on a hit
+        stream << value.toString();
+    }
+}
+
+static void applyInitialProperties(QObject *object, const QVariantMap &properties, QQmlContext *ctx)
+{
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+
+        QQmlProperty p(object, it.key(), ctx);
+        if (!p.isValid()) {
+            qWarning() << "Invalid property " << it.key();
+            continue;
+        }
+        if (!p.write(it.value())) {
+            qWarning() << "Could not set property " << it.key();
+            continue;
+        }
+    }
+}
+
+class PagePoolIncubator : public QQmlIncubator
+{
+public:
+    PagePoolIncubator(const QUrl &url, const QVariantMap &properties, QQmlContext *ctx,
+                      std::function<void(PagePoolIncubator *, QQmlIncubator::Status)> callback)
+        : QQmlIncubator(QQmlIncubator::Asynchronous)
+        , m_url(url)
+        , m_properties(properties)
+        , m_context(ctx)
+        , m_callback(callback)
+    {
+    }
+
+    QUrl url() const
+    {
+        return m_url;
+    }
+
+protected:
+    void setInitialState(QObject *object) override
+    {
+        applyInitialProperties(object, m_properties, m_context);
+    }
+
+    void statusChanged(Status status) override
+    {
+        if (status == Loading || status == Null) {
+            return;
+        }
+        m_callback(this, status);
+    }
+
+private:
+    QUrl m_url;
+    QVariantMap m_properties;
+    QQmlContext *m_context;
+    std::function<void(PagePoolIncubator *, QQmlIncubator::Status)> m_callback;
+};
 
 PagePool::PagePool(QObject *parent)
     : QObject(parent)
 {
+    CacheManager::instance()->registerCache(this);
 }
 
 PagePool::~PagePool()
 {
+    CacheManager::instance()->unregisterCache(this);
+    cancelPrefetch();
+
+    const auto handles = m_pendingLoads.keys();
+    for (int handle : handles) {
+        cancelLoad(handle);
+    }
 }
 
 QUrl PagePool::lastLoadedUrl() const
@@ -50,6 +158,75 @@ bool PagePool::cachePages() const
     return m_cachePages;
 }
 
+void PagePool::setMaximumCachedPages(int maximum)
+{
+    maximum = qMax(0, maximum);
+    if (maximum == m_maximumCachedPages) {
+        return;
+    }
+
+    m_maximumCachedPages = maximum;
+    emit maximumCachedPagesChanged();
+
+    prune();
+}
+
+int PagePool::maximumCachedPages() const
+{
+    return m_maximumCachedPages;
+}
+
+void PagePool::setMaximumPagesPerUrl(int maximum)
+{
+    maximum = qMax(1, maximum);
+    if (maximum == m_maximumPagesPerUrl) {
+        return;
+    }
+
+    m_maximumPagesPerUrl = maximum;
+    emit maximumPagesPerUrlChanged();
+
+    QSet<QUrl> urls;
+    for (auto node = m_lru.first(); node; node = node->next) {
+        if (!node->key.second.isEmpty()) {
+            urls.insert(node->key.first);
+        }
+    }
+    for (const auto &url : qAsConst(urls)) {
+        pruneUrl(url);
+    }
+}
+
+int PagePool::maximumPagesPerUrl() const
+{
+    return m_maximumPagesPerUrl;
+}
+
+void PagePool::setCacheKeyProperties(const QStringList &properties)
+{
+    if (properties == m_cacheKeyProperties) {
+        return;
+    }
+
+    m_cacheKeyProperties = properties;
+    emit cacheKeyPropertiesChanged();
+}
+
+QStringList PagePool::cacheKeyProperties() const
+{
+    return m_cacheKeyProperties;
+}
+
+int PagePool::cachedCost() const
+{
+    return m_lru.totalCost();
+}
+
+int PagePool::cachedCount() const
+{
+    return m_lru.count();
+}
+
 QQuickItem *PagePool::loadPage(const QString &url, QJSValue callback)
 {
     return loadPageWithProperties(url, QVariantMap(), callback);
@@ -57,17 +234,31 @@ QQuickItem *PagePool::loadPage(const QString &url, QJSValue callback)
 
 QQuickItem *PagePool::loadPageWithProperties(
         const QString &url, const QVariantMap &properties, QJSValue callback)
+{
+    return loadPageWithKey(url, cacheKeyForProperties(resolvedUrl(url), properties), properties, callback);
+}
+
+QQuickItem *PagePool::loadPageWithKey(
+        const QString &url, const QString &cacheKey, const QVariantMap &properties, QJSValue callback)
 {
     Q_ASSERT(qmlEngine(this));
     QQmlContext *ctx = QQmlEngine::contextForObject(this);
     Q_ASSERT(ctx);
 
     const QUrl actualUrl = resolvedUrl(url);
+    const CacheKey key(actualUrl, cacheKey);
 
-    auto found = m_itemForUrl.find(actualUrl);
-    if (found != m_itemForUrl.end()) {
-        m_lastLoadedUrl = found.key();
+    // The page is being prefetched, finish it now rather than creating a second instance
+    if (PagePoolIncubator *incubator = m_incubatorForUrl.value(actualUrl)) {
+        incubator->forceCompletion();
+    }
+
+    auto found = m_itemForKey.find(key);
+    if (found != m_itemForKey.end()) {
+        m_lastLoadedUrl = actualUrl;
         m_lastLoadedItem = found.value();
+        ++m_hits;
+        touch(key);
 
         if (callback.isCallable()) {
             QJSValueList args = {qmlEngine(this)->newQObject(found.value())};
@@ -84,6 +275,7 @@ QQuickItem *PagePool::loadPageWithProperties(
         }
     }
 
+    ++m_misses;
     QQmlComponent *component = m_componentForUrl.value(actualUrl);
 
     if (!component) {
@@ -98,23 +290,26 @@ QQuickItem *PagePool::loadPageWithProperties(
         }
 
         connect(component, &QQmlComponent::statusChanged, this,
-                [this, component, callback, properties] (QQmlComponent::Status status) mutable {
+                [this, component, callback, properties, cacheKey] (QQmlComponent::Status status) mutable {
             if (status != QQmlComponent::Ready) {
                 qWarning() << component->errors();
                 m_componentForUrl.remove(component->url());
                 component->deleteLater();
                 return;
             }
-            QQuickItem *item = createFromComponent(component, properties);
+            QQuickItem *item = createFromComponent(component, properties, cacheKey);
             if (item) {
                 QJSValueList args = {qmlEngine(this)->newQObject(item)};
                 callback.call(args);
             }
 
             if (m_cachePages) {
+                m_componentForUrl.remove(component->url());
                 component->deleteLater();
             } else {
                 m_componentForUrl[component->url()] = component;
+                touch(CacheKey(component->url(), QString()));
+                prune();
             }
         });
 
@@ -125,11 +320,14 @@ QQuickItem *PagePool::loadPageWithProperties(
         return nullptr;
     }
 
-    QQuickItem *item = createFromComponent(component, properties);
+    QQuickItem *item = createFromComponent(component, properties, cacheKey);
     if (m_cachePages) {
+        m_componentForUrl.remove(component->url());
         component->deleteLater();
     } else {
         m_componentForUrl[component->url()] = component;
+        touch(CacheKey(component->url(), QString()));
+        prune();
     }
 
     if (callback.isCallable()) {
@@ -146,7 +344,164 @@ QQuickItem *PagePool::loadPageWithProperties(
     }
 }
 
-QQuickItem *PagePool::createFromComponent(QQmlComponent *component, const QVariantMap &properties)
+int PagePool::loadPageAsynchronously(const QString &url, const QVariantMap &properties, QJSValue callback)
+{
+    Q_ASSERT(qmlEngine(this));
+
+    const QUrl actualUrl = resolvedUrl(url);
+    const QString cacheKey = cacheKeyForProperties(actualUrl, properties);
+    const CacheKey key(actualUrl, cacheKey);
+
+    if (PagePoolIncubator *incubator = m_incubatorForUrl.value(actualUrl)) {
+        incubator->forceCompletion();
+    }
+
+    QQuickItem *cached = m_itemForKey.value(key);
+    if (cached) {
+        m_lastLoadedUrl = actualUrl;
+        m_lastLoadedItem = cached;
+        ++m_hits;
+        touch(key);
+
+        if (callback.isCallable()) {
+            QJSValueList args = {qmlEngine(this)->newQObject(cached)};
+            callback.call(args);
+        }
+        emit lastLoadedUrlChanged();
+        emit lastLoadedItemChanged();
+        return 0;
+    }
+
+    ++m_misses;
+    const int handle = m_nextLoadHandle++;
+    m_pendingLoads.insert(handle, nullptr);
+
+    QQmlComponent *component = m_componentForUrl.value(actualUrl);
+    if (!component) {
+        component = new QQmlComponent(qmlEngine(this), actualUrl, QQmlComponent::Asynchronous);
+    }
+
+    if (component->status() == QQmlComponent::Loading) {
+        connect(component, &QQmlComponent::statusChanged, this,
+                [this, component, handle, properties, cacheKey, callback] (QQmlComponent::Status status) {
+            disconnect(component, &QQmlComponent::statusChanged, this, nullptr);
+            if (status != QQmlComponent::Ready) {
+                qWarning() << component->errors();
+                m_pendingLoads.remove(handle);
+                m_componentForUrl.remove(component->url());
+                component->deleteLater();
+                return;
+            }
+
+            if (m_pendingLoads.contains(handle)) {
+                incubateForLoad(handle, component, properties, cacheKey, callback);
+            } else if (!m_cachePages) {
+                // Cancelled, but the compiled component is still useful
+                m_componentForUrl[component->url()] = component;
+                touch(CacheKey(component->url(), QString()));
+                prune();
+            } else {
+                component->deleteLater();
+            }
+        });
+        return handle;
+
+    } else if (component->status() != QQmlComponent::Ready) {
+        qWarning() << component->errors();
+        m_pendingLoads.remove(handle);
+        return 0;
+    }
+
+    incubateForLoad(handle, component, properties, cacheKey, callback);
+    return m_pendingLoads.contains(handle) ? handle : 0;
+}
+
+void PagePool::cancelLoad(int handle)
+{
+    auto it = m_pendingLoads.find(handle);
+    if (it == m_pendingLoads.end()) {
+        return;
+    }
+
+    PagePoolIncubator *incubator = it.value();
+    m_pendingLoads.erase(it);
+
+    // While compiling there is nothing to abort yet: the statusChanged
+    // handler will find the handle gone
+    if (incubator) {
+        incubator->clear();
+        delete incubator;
+    }
+}
+
+void PagePool::incubateForLoad(int handle, QQmlComponent *component, const QVariantMap &properties, const QString &cacheKey, QJSValue callback)
+{
+    QQmlContext *ctx = QQmlEngine::contextForObject(this);
+    Q_ASSERT(ctx);
+
+    const QUrl url = component->url();
+
+    auto incubator = new PagePoolIncubator(url, properties, ctx,
+                                           [this, handle, properties, cacheKey, callback](PagePoolIncubator *incubator, QQmlIncubator::Status status) mutable {
+        m_pendingLoads.remove(handle);
+
+        // Deleting the incubator from within its own statusChanged() is not safe
+        QTimer::singleShot(0, [incubator]() {
+            delete incubator;
+        });
+
+        if (status != QQmlIncubator::Ready) {
+            qWarning() << incubator->errors();
+            return;
+        }
+
+        QObject *obj = incubator->object();
+        QQuickItem *item = qobject_cast<QQuickItem *>(obj);
+        if (!item) {
+            obj->deleteLater();
+            return;
+        }
+
+        const QUrl url = incubator->url();
+        const CacheKey key(url, cacheKey);
+        if (!m_cachePages) {
+            QQmlEngine::setObjectOwnership(item, QQmlEngine::JavaScriptOwnership);
+        } else if (QQuickItem *existing = m_itemForKey.value(key)) {
+            // Loaded in the meantime by somebody else: keep pages unique per key
+            item->deleteLater();
+            item = existing;
+            touch(key);
+        } else {
+            addToCache(key, item, properties);
+        }
+
+        m_lastLoadedUrl = url;
+        m_lastLoadedItem = item;
+        emit lastLoadedUrlChanged();
+        emit lastLoadedItemChanged();
+
+        if (callback.isCallable()) {
+            QJSValueList args = {qmlEngine(this)->newQObject(item)};
+            callback.call(args);
+        }
+    });
+
+    m_pendingLoads[handle] = incubator;
+    component->create(*incubator, ctx);
+
+    // The incubator keeps what it needs from the component, so the same rules
+    // as the synchronous path apply
+    if (m_cachePages) {
+        m_componentForUrl.remove(url);
+        component->deleteLater();
+    } else {
+        m_componentForUrl[url] = component;
+        touch(CacheKey(url, QString()));
+        prune();
+    }
+}
+
+QQuickItem *PagePool::createFromComponent(QQmlComponent *component, const QVariantMap &properties, const QString &cacheKey)
 {
     QQmlContext *ctx = QQmlEngine::contextForObject(this);
     Q_ASSERT(ctx);
@@ -159,18 +514,7 @@ QQuickItem *PagePool::createFromComponent(QQmlComponent *component, const QVaria
         return nullptr;
     }
 
-    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
-
-        QQmlProperty p(obj, it.key(), ctx);
-        if (!p.isValid()) {
-            qWarning() << "Invalid property " << it.key();
-            continue;
-        }
-        if (!p.write(it.value())) {
-            qWarning() << "Could not set property " << it.key();
-            continue;
-        }
-    }
+    applyInitialProperties(obj, properties, ctx);
 
     component->completeCreate();
 
@@ -184,8 +528,7 @@ QQuickItem *PagePool::createFromComponent(QQmlComponent *component, const QVaria
     m_lastLoadedItem = item;
 
     if (m_cachePages) {
-        QQmlEngine::setObjectOwnership(item, QQmlEngine::CppOwnership);
-        m_itemForUrl[component->url()] = item;
+        addToCache(CacheKey(component->url(), cacheKey), item, properties);
     } else {
         QQmlEngine::setObjectOwnership(item, QQmlEngine::JavaScriptOwnership);
     }
@@ -195,6 +538,200 @@ QQuickItem *PagePool::createFromComponent(QQmlComponent *component, const QVaria
     return item;
 }
 
+void PagePool::addToCache(const CacheKey &key, QQuickItem *item, const QVariantMap &properties)
+{
+    QQmlEngine::setObjectOwnership(item, QQmlEngine::CppOwnership);
+    m_itemForKey[key] = item;
+    m_keyForItem[item] = key;
+    updateSize(key);
+
+    // Keys only get reserved by pages actually cached: loads that fail or
+    // get cancelled leave nothing behind. Explicit keys of loadPageWithKey()
+    // don't match the one of their properties.
+    if (!key.second.isEmpty() && cacheKeyForProperties(key.first, properties) == key.second) {
+        m_keyPropertiesForKey.insert(key, keyProperties(properties));
+    }
+
+    // A page that just left its PageRow may now be evicted.
+    // Queued, as it may be getting pushed somewhere else right away.
+    connect(item, &QQuickItem::parentChanged, this, [this](QQuickItem *parent) {
+        if (!parent) {
+            prune();
+        }
+    }, Qt::QueuedConnection);
+    connect(item, &QObject::destroyed, this, [this, item]() {
+        const CacheKey key = m_keyForItem.take(item);
+        if (!key.first.isEmpty() && m_itemForKey.value(key) == item) {
+            m_itemForKey.remove(key);
+            m_keyPropertiesForKey.remove(key);
+            removeFromLru(key);
+            emit cacheStatisticsChanged();
+        }
+    });
+    // The running total of the costs follows the cost of the page
+    auto attached = qobject_cast<PagePoolAttached *>(qmlAttachedPropertiesObject<PagePool>(item, true));
+    connect(attached, &PagePoolAttached::costChanged, this, [this, item]() {
+        const CacheKey key = m_keyForItem.value(item);
+        if (m_itemForKey.value(key) == item) {
+            m_lru.setCost(key, costForKey(key));
+            emit cacheStatisticsChanged();
+            prune();
+        }
+    });
+
+    touch(key);
+    if (!key.second.isEmpty()) {
+        pruneUrl(key.first);
+    }
+    prune();
+}
+
+void PagePool::prefetch(const QStringList &urls, int priority, bool instantiate)
+{
+    Q_ASSERT(qmlEngine(this));
+
+    for (const QString &url : urls) {
+        PrefetchRequest request{resolvedUrl(url), priority, instantiate};
+
+        // Already requested: keep the highest priority
+        for (int i = 0; i < m_prefetchQueue.count(); ++i) {
+            if (m_prefetchQueue[i].url == request.url) {
+                request.priority = qMax(request.priority, m_prefetchQueue[i].priority);
+                request.instantiate = request.instantiate || m_prefetchQueue[i].instantiate;
+                m_prefetchQueue.removeAt(i);
+                break;
+            }
+        }
+
+        auto it = m_prefetchQueue.begin();
+        while (it != m_prefetchQueue.end() && it->priority >= request.priority) {
+            ++it;
+        }
+        m_prefetchQueue.insert(it, request);
+    }
+
+    processPrefetchQueue();
+}
+
+void PagePool::cancelPrefetch()
+{
+    m_prefetchQueue.clear();
+
+    if (m_prefetchComponent) {
+        disconnect(m_prefetchComponent, nullptr, this, nullptr);
+        m_prefetchComponent->deleteLater();
+        m_prefetchComponent = nullptr;
+    }
+
+    const auto incubators = m_incubatorForUrl;
+    m_incubatorForUrl.clear();
+    for (auto *incubator : incubators) {
+        // Aborts the incubation and deletes the partially created object
+        incubator->clear();
+        delete incubator;
+    }
+}
+
+void PagePool::processPrefetchQueue()
+{
+    while (!m_prefetchComponent && !m_prefetchQueue.isEmpty()) {
+        const PrefetchRequest request = m_prefetchQueue.takeFirst();
+
+        if (m_itemForKey.contains(CacheKey(request.url, QString())) || m_incubatorForUrl.contains(request.url)) {
+            continue;
+        }
+
+        QQmlComponent *component = m_componentForUrl.value(request.url);
+        if (!component) {
+            component = new QQmlComponent(qmlEngine(this), request.url, QQmlComponent::Asynchronous);
+        }
+
+        if (component->status() == QQmlComponent::Loading) {
+            // One compilation at a time, so the queue order is respected
+            m_prefetchComponent = component;
+            const bool instantiate = request.instantiate;
+            connect(component, &QQmlComponent::statusChanged, this, [this, component, instantiate]() {
+                disconnect(component, nullptr, this, nullptr);
+                m_prefetchComponent = nullptr;
+                prefetchComponentReady(component, instantiate);
+                processPrefetchQueue();
+            });
+            return;
+        }
+
+        prefetchComponentReady(component, request.instantiate);
+    }
+}
+
+void PagePool::prefetchComponentReady(QQmlComponent *component, bool instantiate)
+{
+    const QUrl url = component->url();
+
+    if (component->status() != QQmlComponent::Ready) {
+        qWarning() << component->errors();
+        if (m_componentForUrl.value(url) == component) {
+            m_componentForUrl.remove(url);
+        }
+        component->deleteLater();
+        return;
+    }
+
+    // loadPage() created the page in the meantime
+    if (m_cachePages && m_itemForKey.contains(CacheKey(url, QString()))) {
+        if (m_componentForUrl.value(url) == component) {
+            m_componentForUrl.remove(url);
+        }
+        component->deleteLater();
+        return;
+    }
+
+    m_componentForUrl[url] = component;
+    touch(CacheKey(url, QString()));
+
+    if (!instantiate || !m_cachePages) {
+        prune();
+        emit prefetched(url);
+        return;
+    }
+
+    QQmlContext *ctx = QQmlEngine::contextForObject(this);
+    Q_ASSERT(ctx);
+
+    auto incubator = new PagePoolIncubator(url, QVariantMap(), ctx,
+                                           [this](PagePoolIncubator *incubator, QQmlIncubator::Status status) {
+        const QUrl url = incubator->url();
+        if (m_incubatorForUrl.value(url) == incubator) {
+            m_incubatorForUrl.remove(url);
+        }
+
+        if (status == QQmlIncubator::Ready) {
+            QObject *obj = incubator->object();
+            QQuickItem *item = qobject_cast<QQuickItem *>(obj);
+            if (!item) {
+                obj->deleteLater();
+            } else {
+                addToCache(CacheKey(url, QString()), item, QVariantMap());
+                // Same as loadPage: once there is an instance the component isn't needed anymore
+                QQmlComponent *component = m_componentForUrl.take(url);
+                if (component) {
+                    component->deleteLater();
+                }
+                emit prefetched(url);
+            }
+        } else {
+            qWarning() << incubator->errors();
+        }
+
+        // Deleting the incubator from within its own statusChanged() is not safe
+        QTimer::singleShot(0, [incubator]() {
+            delete incubator;
+        });
+    });
+
+    m_incubatorForUrl[url] = incubator;
+    component->create(*incubator, ctx);
+}
+
 QUrl PagePool::resolvedUrl(const QString &stringUrl) const
 {
     Q_ASSERT(qmlEngine(this));
@@ -215,21 +752,37 @@ bool PagePool::isLocalUrl(const QUrl &url)
 
 QUrl PagePool::urlForPage(QQuickItem *item) const
 {
-    return m_urlForItem.value(item);
+    return m_keyForItem.value(item).first;
 }
 
 QQuickItem *PagePool::pageForUrl(const QUrl &url) const
 {
-    return m_itemForUrl.value(resolvedUrl(url.toString()), nullptr);
+    return pageForResolvedUrl(resolvedUrl(url.toString()));
+}
+
+QQuickItem *PagePool::pageForResolvedUrl(const QUrl &url) const
+{
+    QQuickItem *item = m_itemForKey.value(CacheKey(url, QString()));
+    if (item) {
+        return item;
+    }
+
+    // Otherwise the most recently used page loaded with a cache key
+    for (auto node = m_lru.first(); node; node = node->next) {
+        if (node->key.first == url && !node->key.second.isEmpty()) {
+            return m_itemForKey.value(node->key);
+        }
+    }
+    return nullptr;
 }
 
 bool PagePool::contains(const QVariant &page) const
 {
     if (page.canConvert<QQuickItem *>()) {
-        return m_urlForItem.contains(page.value<QQuickItem *>());
+        return m_keyForItem.contains(page.value<QQuickItem *>());
     } else if (page.canConvert<QString>()) {
         const QUrl actualUrl = resolvedUrl(page.value<QString>());
-        return m_itemForUrl.contains(actualUrl);
+        return pageForResolvedUrl(actualUrl) != nullptr;
     } else {
         return false;
     }
@@ -241,9 +794,9 @@ void PagePool::deletePage(const QVariant &page)
         return;
     }
 
-    QQuickItem *item;
+    QList<CacheKey> keys;
     if (page.canConvert<QQuickItem *>()) {
-        item = page.value<QQuickItem *>();
+        keys << m_keyForItem.value(page.value<QQuickItem *>());
     } else if (page.canConvert<QString>()) {
         QString url = page.value<QString>();
         if (url.isEmpty()) {
@@ -251,48 +804,305 @@ void PagePool::deletePage(const QVariant &page)
         }
         const QUrl actualUrl = resolvedUrl(page.value<QString>());
 
-        item = m_itemForUrl.value(actualUrl);
+        // All the instances loaded from this url
+        for (auto it = m_itemForKey.constBegin(); it != m_itemForKey.constEnd(); ++it) {
+            if (it.key().first == actualUrl) {
+                keys << it.key();
+            }
+        }
     } else {
         return;
     }
 
-    if (!item) {
-        return;
-    }
-
-    const QUrl url = m_urlForItem.value(item);
+    for (const auto &key : qAsConst(keys)) {
+        QQuickItem *item = m_itemForKey.take(key);
+        m_keyPropertiesForKey.remove(key);
+        if (!item) {
+            continue;
+        }
 
-    if (url.isEmpty()) {
-        return;
+        m_keyForItem.remove(item);
+        removeFromLru(key);
+        disconnect(item, nullptr, this, nullptr);
+        item->deleteLater();
     }
 
-    m_itemForUrl.remove(url);
-    m_urlForItem.remove(item);
-    item->deleteLater();
+    emit cacheStatisticsChanged();
 }
 
 void PagePool::clear()
 {
+    cancelPrefetch();
+
+    const auto handles = m_pendingLoads.keys();
+    for (int handle : handles) {
+        cancelLoad(handle);
+    }
+
     for (auto *c : qAsConst(m_componentForUrl)) {
         c->deleteLater();
     }
     m_componentForUrl.clear();
 
-    for (auto *i : qAsConst(m_itemForUrl)) {
+    for (auto *i : qAsConst(m_itemForKey)) {
+        disconnect(i, nullptr, this, nullptr);
         // items that had been deparented are safe to delete
         if (!i->parentItem()) {
             i->deleteLater();
         }
         QQmlEngine::setObjectOwnership(i, QQmlEngine::JavaScriptOwnership);
     }
-    m_itemForUrl.clear();
+    m_itemForKey.clear();
+    m_keyPropertiesForKey.clear();
 
-    m_urlForItem.clear();
+    m_keyForItem.clear();
+    m_lru.clear();
+    m_sizeForKey.clear();
+    m_cachedSize = 0;
     m_lastLoadedUrl = QUrl();
     m_lastLoadedItem = nullptr;
     
     emit lastLoadedUrlChanged();
     emit lastLoadedItemChanged();
+    emit cacheStatisticsChanged();
+}
+
+QVariantMap PagePool::cacheStatistics() const
+{
+    return {
+        {QStringLiteral("hits"), m_hits},
+        {QStringLiteral("misses"), m_misses},
+        {QStringLiteral("evictions"), m_evictions},
+        {QStringLiteral("count"), cachedCount()},
+        {QStringLiteral("cost"), cachedCost()},
+        {QStringLiteral("maximum"), m_maximumCachedPages},
+        {QStringLiteral("size"), m_cachedSize}
+    };
+}
+
+QVariantMap PagePool::keyProperties(const QVariantMap &properties) const
+{
+    QVariantMap selected;
+    for (const auto &name : qAsConst(m_cacheKeyProperties)) {
+        auto it = properties.constFind(name);
+        if (it != properties.constEnd()) {
+            selected[name] = it.value();
+        }
+    }
+    return selected;
+}
+
+QString PagePool::cacheKeyForProperties(const QUrl &url, const QVariantMap &properties) const
+{
+    if (!m_cachePages || m_cacheKeyProperties.isEmpty()) {
+        return QString();
+    }
+
+    const QVariantMap selected = keyProperties(properties);
+    if (selected.isEmpty()) {
+        return QString();
+    }
+
+    // Unlike JSON, QDataStream keeps the alpha of colors, the milliseconds
+    // of dates, points, sizes and rects. QVariantMap is sorted by key, so
+    // this is stable.
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    writeKeyValue(stream, selected);
+    const QString baseKey = QString::fromLatin1(data.toBase64());
+
+    // Values that can't be streamed may still share a key, so pages are
+    // only reused for properties that compare equal
+    QString key = baseKey;
+    for (int i = 1; ; ++i) {
+        auto it = m_keyPropertiesForKey.constFind(CacheKey(url, key));
+        if (it == m_keyPropertiesForKey.constEnd() || it.value() == selected) {
+            return key;
+        }
+        key = baseKey + QLatin1Char('#') + QString::number(i);
+    }
+}
+
+void PagePool::touch(const CacheKey &key)
+{
+    if (!m_sizeForKey.contains(key)) {
+        updateSize(key);
+    }
+    if (m_lru.touch(key, costForKey(key))) {
+        emit cacheStatisticsChanged();
+    }
+}
+
+void PagePool::removeFromLru(const CacheKey &key)
+{
+    if (!key.second.isEmpty() || !m_componentForUrl.contains(key.first)) {
+        m_lru.remove(key);
+    } else {
+        // Only the component of the url is left
+        m_lru.setCost(key, costForKey(key));
+    }
+    updateSize(key);
+}
+
+void PagePool::updateSize(const CacheKey &key)
+{
+    // Measured once, as walking a page on every hit would be too slow
+    const QObject *object = m_itemForKey.value(key);
+    if (!object && key.second.isEmpty()) {
+        object = m_componentForUrl.value(key.first);
+    }
+
+    const qint64 size = CacheManager::estimateSize(object);
+    m_cachedSize += size - m_sizeForKey.value(key);
+    if (object) {
+        m_sizeForKey.insert(key, size);
+    } else {
+        m_sizeForKey.remove(key);
+    }
+}
+
+int PagePool::costForKey(const CacheKey &key) const
+{
+    QQuickItem *item = m_itemForKey.value(key);
+    if (!item) {
+        // Only the component is cached
+        return 1;
+    }
+
+    auto attached = qobject_cast<PagePoolAttached *>(qmlAttachedPropertiesObject<PagePool>(item, false));
+    return attached ? attached->cost() : 1;
+}
+
+void PagePool::prune()
+{
+    if (m_maximumCachedPages > 0) {
+        // Never evict the most recently loaded page: it's about to be shown
+        trimTo(m_maximumCachedPages, std::numeric_limits<qint64>::max(), true);
+    }
+    CacheManager::instance()->cacheChanged(this);
+}
+
+void PagePool::trimTo(int maximumCost, qint64 maximumSize, bool keepMostRecent)
+{
+    auto node = m_lru.last();
+    while (node && (m_lru.totalCost() > maximumCost || m_cachedSize > maximumSize)) {
+        if (keepMostRecent && node == m_lru.first()) {
+            break;
+        }
+        const CacheKey key = node->key;
+        node = node->previous;
+
+        QQuickItem *item = m_itemForKey.value(key);
+        // Pages currently in a PageRow (or anywhere else in the scene) are in use
+        if (item && item->parentItem()) {
+            continue;
+        }
+        evict(key);
+    }
+}
+
+QString PagePool::cacheName() const
+{
+    return objectName().isEmpty() ? QStringLiteral("PagePool") : QStringLiteral("PagePool ") + objectName();
+}
+
+int PagePool::cachePriority() const
+{
+    // Pages are the most expensive to recreate
+    return 20;
+}
+
+qint64 PagePool::cacheCost() const
+{
+    return m_cachedSize;
+}
+
+int PagePool::cacheCount() const
+{
+    return cachedCount();
+}
+
+void PagePool::trimCache(qint64 maximumCost)
+{
+    trimTo(std::numeric_limits<int>::max(), maximumCost, false);
+}
+
+void PagePool::pruneUrl(const QUrl &url)
+{
+    int count = 0;
+    auto node = m_lru.first();
+    while (node) {
+        const CacheKey key = node->key;
+        // The first one is the most recently used, always keep it
+        const bool mostRecent = node == m_lru.first();
+        node = node->next;
+        if (key.first != url || key.second.isEmpty()) {
+            continue;
+        }
+
+        ++count;
+        if (count <= m_maximumPagesPerUrl || mostRecent) {
+            continue;
+        }
+
+        QQuickItem *item = m_itemForKey.value(key);
+        if (item && item->parentItem()) {
+            continue;
+        }
+        evict(key);
+    }
+}
+
+void PagePool::evict(const CacheKey &key)
+{
+    QQuickItem *item = m_itemForKey.take(key);
+    m_keyPropertiesForKey.remove(key);
+    if (item) {
+        m_keyForItem.remove(item);
+        disconnect(item, nullptr, this, nullptr);
+        item->deleteLater();
+    }
+
+    // Keyed entries only hold a page, the component is shared with the plain url entry
+    if (key.second.isEmpty()) {
+        QQmlComponent *component = m_componentForUrl.take(key.first);
+        if (component) {
+            component->deleteLater();
+        }
+    }
+
+    m_lru.remove(key);
+    updateSize(key);
+    ++m_evictions;
+
+    emit evicted(key.first);
+    emit cacheStatisticsChanged();
+}
+
+PagePoolAttached *PagePool::qmlAttachedProperties(QObject *object)
+{
+    return new PagePoolAttached(object);
+}
+
+PagePoolAttached::PagePoolAttached(QObject *parent)
+    : QObject(parent)
+{
+}
+
+int PagePoolAttached::cost() const
+{
+    return m_cost;
+}
+
+void PagePoolAttached::setCost(int cost)
+{
+    cost = qMax(0, cost);
+    if (cost == m_cost) {
+        return;
+    }
+
+    m_cost = cost;
+    emit costChanged();
 }
 
 #include "moc_pagepool.cpp"
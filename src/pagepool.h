@@ -9,6 +9,12 @@
 #include <QQuickItem>
 #include <QPointer>
 
+#include "cachemanager.h"
+#include "costlru.h"
+
+class PagePoolAttached;
+class PagePoolIncubator;
+
 /**
  * A Pool of Page items, pages will be unique per url and the items
  * will be kept around unless explicitly deleted.
@@ -17,9 +23,25 @@
  * url, you should instantiate them in the traditional way
  * or use a different PagePool instance.
  *
+ * If maximumCachedPages is set, the least recently used pages that are not
+ * currently shown in a PageRow get evicted once the combined cost of the
+ * cached pages exceeds it. A page can declare how expensive it is with the
+ * PagePool.cost attached property:
+ *
+ * @code{.qml}
+ * Kirigami.Page {
+ *     Kirigami.PagePool.cost: 4
+ * }
+ * @endcode
+ *
+ * Pages that show different content depending on their initial properties,
+ * such as detail pages, can still be cached by giving them a cache key,
+ * either explicitly with loadPageWithKey() or through cacheKeyProperties.
+ * Up to maximumPagesPerUrl of those are kept for each url.
+ *
  * @see org::kde::kirigami::PagePoolAction
  */
-class PagePool : public QObject
+class PagePool : public QObject, public ManagedCache
 {
     Q_OBJECT
     /**
@@ -40,6 +62,55 @@ class PagePool : public QObject
      */
     Q_PROPERTY(bool cachePages READ cachePages WRITE setCachePages NOTIFY cachePagesChanged)
 
+    /**
+     * The maximum combined cost of the pages kept in the cache.
+     * Every page costs 1 unless it sets the PagePool.cost attached property.
+     * When the limit is exceeded, the least recently loaded pages are deleted,
+     * except the ones currently parented to a PageRow or another item.
+     * 0 (default) means the cache is unbounded.
+     * @since 5.78
+     */
+    Q_PROPERTY(int maximumCachedPages READ maximumCachedPages WRITE setMaximumCachedPages NOTIFY maximumCachedPagesChanged)
+
+    /**
+     * Names of the initial properties that identify a page instance.
+     * When not empty, loadPageWithProperties() caches one instance per url
+     * and per combination of values of those properties, instead of
+     * one instance per url. Properties not listed are only applied when
+     * the page is created.
+     *
+     * @code{.qml}
+     * Kirigami.PagePool {
+     *     id: pool
+     *     cacheKeyProperties: ["itemId"]
+     * }
+     * ...
+     * pageStack.push(pool.loadPageWithProperties("DetailsPage.qml", {"itemId": model.id}))
+     * @endcode
+     * @since 5.78
+     */
+    Q_PROPERTY(QStringList cacheKeyProperties READ cacheKeyProperties WRITE setCacheKeyProperties NOTIFY cacheKeyPropertiesChanged)
+
+    /**
+     * How many instances loaded with a cache key are kept for a single url.
+     * The least recently used ones that are not in a PageRow are deleted first.
+     * Default is 5.
+     * @since 5.78
+     */
+    Q_PROPERTY(int maximumPagesPerUrl READ maximumPagesPerUrl WRITE setMaximumPagesPerUrl NOTIFY maximumPagesPerUrlChanged)
+
+    /**
+     * The combined cost of all the pages and components currently in the cache.
+     * @since 5.78
+     */
+    Q_PROPERTY(int cachedCost READ cachedCost NOTIFY cacheStatisticsChanged)
+
+    /**
+     * How many pages and components are currently in the cache.
+     * @since 5.78
+     */
+    Q_PROPERTY(int cachedCount READ cachedCount NOTIFY cacheStatisticsChanged)
+
 public:
     PagePool(QObject *parent = nullptr);
     ~PagePool();
@@ -50,6 +121,18 @@ public:
     void setCachePages(bool cache);
     bool cachePages() const;
 
+    void setMaximumCachedPages(int maximum);
+    int maximumCachedPages() const;
+
+    void setCacheKeyProperties(const QStringList &properties);
+    QStringList cacheKeyProperties() const;
+
+    void setMaximumPagesPerUrl(int maximum);
+    int maximumPagesPerUrl() const;
+
+    int cachedCost() const;
+    int cachedCount() const;
+
     /**
      * Returns the instance of the item defined in the QML file identified
      * by url, only one instance will be made per url if cachePAges is true. If the url is remote (i.e. http) don't rely on the return value but us the async callback instead
@@ -67,13 +150,53 @@ public:
     Q_INVOKABLE QQuickItem *loadPageWithProperties(
             const QString &url, const QVariantMap &properties, QJSValue callback = QJSValue());
 
+    /**
+     * Same as loadPageWithProperties(), but pages are cached per url and cacheKey:
+     * loading again the same url with the same key returns the same instance,
+     * while a different key creates a new one.
+     * An empty cacheKey behaves as loadPageWithProperties().
+     * @since 5.78
+     */
+    Q_INVOKABLE QQuickItem *loadPageWithKey(
+            const QString &url, const QString &cacheKey, const QVariantMap &properties = QVariantMap(), QJSValue callback = QJSValue());
+
+    /**
+     * Loads the page at url without blocking the event loop: the QML is compiled
+     * in the background and the page is instantiated with a QQmlIncubator over
+     * several frames. The initial properties are set before the page
+     * gets completed, as with loadPageWithProperties().
+     * If the page is already in the cache, callback is called right away.
+     *
+     * @code{.qml}
+     * pool.loadPageAsynchronously("DetailsPage.qml", {"itemId": 42}, function(page) {
+     *     pageStack.push(page)
+     * })
+     * @endcode
+     *
+     * @param callback called with the page instance once it's ready
+     * @returns a handle which can be passed to cancelLoad(), or 0 if the
+     *          callback has already been called
+     * @since 5.78
+     */
+    Q_INVOKABLE int loadPageAsynchronously(
+            const QString &url, const QVariantMap &properties, QJSValue callback);
+
+    /**
+     * Cancels a pending loadPageAsynchronously(): the callback won't be called
+     * and the partially created page is deleted.
+     * @param handle the value returned by loadPageAsynchronously()
+     * @since 5.78
+     */
+    Q_INVOKABLE void cancelLoad(int handle);
+
     /**
      * @returns The url of the page for the given instance, empty if there is no correspondence
      */
     Q_INVOKABLE QUrl urlForPage(QQuickItem *item) const;
 
     /**
-     * @returns The page associated with a given URL, nullptr if there is no correspondence
+     * @returns The page associated with a given URL, nullptr if there is no correspondence.
+     * If the url has only pages loaded with a cache key, the most recently used one is returned.
      */
     Q_INVOKABLE QQuickItem *pageForUrl(const QUrl &url) const;
 
@@ -85,7 +208,8 @@ public:
 
     /**
      * Deletes the page (only if is managed by the pool.
-     * @param page either the url or the instance of the page
+     * @param page either the url or the instance of the page.
+     *        For an url, all the instances loaded with a cache key are deleted as well
      */
     Q_INVOKABLE void deletePage(const QVariant &page);
 
@@ -105,20 +229,158 @@ public:
      */
     Q_INVOKABLE void clear();
 
+    /**
+     * @returns statistics about the cache usage, useful to tune maximumCachedPages.
+     * The map contains the keys "hits", "misses", "evictions", "count", "cost",
+     * "maximum" and "size", the estimated size of the cached pages in bytes,
+     * as reported to CacheManager.
+     * @since 5.78
+     */
+    Q_INVOKABLE QVariantMap cacheStatistics() const;
+
+    /**
+     * Compiles the pages at the given urls in the background, so that
+     * a later call to loadPage() for them doesn't block on compiling the QML.
+     * Requests with a higher priority are processed first.
+     * Pending requests are cancelled by clear().
+     *
+     * @code{.qml}
+     * Component.onCompleted: pool.prefetch(["SettingsPage.qml", "AboutPage.qml"])
+     * @endcode
+     *
+     * @param urls the pages to compile, same format as the url of loadPage()
+     * @param priority requests with a higher value are processed first
+     * @param instantiate if true and cachePages is true, the pages are also
+     *        instantiated asynchronously and put in the cache, so loadPage()
+     *        will return them immediately
+     * @since 5.78
+     */
+    Q_INVOKABLE void prefetch(const QStringList &urls, int priority = 0, bool instantiate = false);
+
+    /**
+     * Cancels all the pending prefetch requests.
+     * Pages already prefetched stay in the pool.
+     * @since 5.78
+     */
+    Q_INVOKABLE void cancelPrefetch();
+
+    //QML attached property
+    static PagePoolAttached *qmlAttachedProperties(QObject *object);
+
+    // ManagedCache
+    QString cacheName() const override;
+    int cachePriority() const override;
+    qint64 cacheCost() const override;
+    int cacheCount() const override;
+    void trimCache(qint64 maximumCost) override;
+
 Q_SIGNALS:
     void lastLoadedUrlChanged();
     void lastLoadedItemChanged();
     void cachePagesChanged();
+    void maximumCachedPagesChanged();
+    void cacheKeyPropertiesChanged();
+    void maximumPagesPerUrlChanged();
+    void cacheStatisticsChanged();
+
+    /**
+     * Emitted when the page (or component) loaded from url got removed
+     * from the cache because maximumCachedPages was exceeded.
+     */
+    void evicted(const QUrl &url);
+
+    /**
+     * Emitted when the page at url has been compiled (and instantiated if
+     * requested) by prefetch().
+     */
+    void prefetched(const QUrl &url);
 
 private:
-    QQuickItem *createFromComponent(QQmlComponent *component, const QVariantMap &properties);
+    // The url of the page and its cache key, empty for pages unique per url
+    using CacheKey = QPair<QUrl, QString>;
+
+    QQuickItem *createFromComponent(QQmlComponent *component, const QVariantMap &properties, const QString &cacheKey);
+    QQuickItem *pageForResolvedUrl(const QUrl &url) const;
+    QVariantMap keyProperties(const QVariantMap &properties) const;
+    QString cacheKeyForProperties(const QUrl &url, const QVariantMap &properties) const;
+    void touch(const CacheKey &key);
+    void removeFromLru(const CacheKey &key);
+    void updateSize(const CacheKey &key);
+    int costForKey(const CacheKey &key) const;
+    void prune();
+    void trimTo(int maximumCost, qint64 maximumSize, bool keepMostRecent);
+    void pruneUrl(const QUrl &url);
+    void evict(const CacheKey &key);
+    void addToCache(const CacheKey &key, QQuickItem *item, const QVariantMap &properties);
+    void processPrefetchQueue();
+    void prefetchComponentReady(QQmlComponent *component, bool instantiate);
+    void incubateForLoad(int handle, QQmlComponent *component, const QVariantMap &properties, const QString &cacheKey, QJSValue callback);
+
+    struct PrefetchRequest {
+        QUrl url;
+        int priority;
+        bool instantiate;
+    };
 
     QUrl m_lastLoadedUrl;
     QPointer <QQuickItem> m_lastLoadedItem;
-    QHash<QUrl, QQuickItem *> m_itemForUrl;
+    QHash<CacheKey, QQuickItem *> m_itemForKey;
     QHash<QUrl, QQmlComponent *> m_componentForUrl;
-    QHash<QQuickItem *, QUrl> m_urlForItem;
+    QHash<QQuickItem *, CacheKey> m_keyForItem;
+    // The cacheKeyProperties values behind the keys made by cacheKeyForProperties(),
+    // for the pages in m_itemForKey
+    QHash<CacheKey, QVariantMap> m_keyPropertiesForKey;
+    // The cached pages and components, with the cost of each
+    CostLru<CacheKey> m_lru;
+    // The estimated size in bytes of the entries of m_lru, measured when cached
+    QHash<CacheKey, qint64> m_sizeForKey;
+    qint64 m_cachedSize = 0;
+    QStringList m_cacheKeyProperties;
+
+    // Sorted by descending priority
+    QList<PrefetchRequest> m_prefetchQueue;
+    QQmlComponent *m_prefetchComponent = nullptr;
+    QHash<QUrl, PagePoolIncubator *> m_incubatorForUrl;
+
+    // Pending loadPageAsynchronously() calls, the incubator is null while compiling
+    QHash<int, PagePoolIncubator *> m_pendingLoads;
+    int m_nextLoadHandle = 1;
 
     bool m_cachePages = true;
+    int m_maximumCachedPages = 0;
+    int m_maximumPagesPerUrl = 5;
+    int m_hits = 0;
+    int m_misses = 0;
+    int m_evictions = 0;
 };
 
+/**
+ * Attached property of PagePool, to be set on the root item of a page
+ * loaded by a PagePool.
+ * @since 5.78
+ */
+class PagePoolAttached : public QObject
+{
+    Q_OBJECT
+    /**
+     * How expensive this page is on memory. The combined cost of
+     * cached pages will not exceed PagePool.maximumCachedPages.
+     * Default is 1.
+     */
+    Q_PROPERTY(int cost READ cost WRITE setCost NOTIFY costChanged)
+
+public:
+    explicit PagePoolAttached(QObject *parent = nullptr);
+
+    int cost() const;
+    void setCost(int cost);
+
+Q_SIGNALS:
+    void costChanged();
+
+private:
+    int m_cost = 1;
+};
+
+QML_DECLARE_TYPEINFO(PagePool, QML_HAS_ATTACHED_PROPERTIES)
+
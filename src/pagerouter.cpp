@@ -4,14 +4,156 @@
  *  SPDX-License-Identifier: LGPL-2.0-or-later
  */
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
 #include <QJsonValue>
 #include <QJsonObject>
 #include <QJSValue>
 #include <QJSEngine>
+#include <QQmlIncubator>
 #include <QQmlProperty>
 #include <QQuickWindow>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
 #include "pagerouter.h"
 
+/**
+ * Creates the item of a preloaded route asynchronously, spread over
+ * several frames by the engine's incubation controller.
+ */
+class PreloadIncubator : public QQmlIncubator
+{
+public:
+    PreloadIncubator(PageRouter *router, ParsedRoute *route)
+        : QQmlIncubator(QQmlIncubator::Asynchronous)
+        , m_router(router)
+        , m_route(route)
+    {
+    }
+
+    ParsedRoute *route() const
+    {
+        return m_route;
+    }
+
+protected:
+    void setInitialState(QObject *object) override
+    {
+        // Same as what PageRouter::push does between beginCreate and completeCreate
+        object->setParent(m_router);
+        auto qqItem = qobject_cast<QQuickItem*>(object);
+        if (!qqItem) {
+            qCritical() << "Route" << m_route->name << "is not an item! This is undefined behaviour and will likely crash your application.";
+        }
+        for ( auto it = m_route->properties.begin(); it != m_route->properties.end(); it++ ) {
+            object->setProperty(qUtf8Printable(it.key()), it.value());
+        }
+        m_route->setItem(qqItem);
+        m_route->cache = true;
+        m_router->registerRouteItem(m_route);
+        auto attached = qobject_cast<PageRouterAttached*>(qmlAttachedPropertiesObject<PageRouter>(object, true));
+        attached->m_router = m_router;
+    }
+
+    void statusChanged(Status status) override
+    {
+        if (status == Loading || status == Null) {
+            return;
+        }
+        m_router->preloadIncubated(this, status);
+    }
+
+private:
+    PageRouter *m_router;
+    ParsedRoute *m_route;
+};
+
+static quint32 combineHash(quint32 seed, quint32 hash)
+{
+    return seed ^ (hash + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+// Strings holding a number compare equal to it, so they hash as that number
+static quint32 hashString(const QString &string, quint32 seed)
+{
+    bool isNumber = false;
+    const double number = string.toDouble(&isNumber);
+    return isNumber ? qHash(number, seed) : qHash(string, seed);
+}
+
+// Must be consistent with QVariant::operator== for the values
+// routes usually carry. QVariant converts scalars of different types
+// before comparing them: numbers from JavaScript can arrive either as int
+// or as double, booleans equal 0 and 1 and "1" equals 1, so all of those
+// are hashed as double.
+static quint32 hashVariant(const QVariant &value, quint32 seed = 0)
+{
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+        return seed;
+    case QMetaType::Bool:
+        return qHash(value.toBool() ? 1.0 : 0.0, seed);
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Float:
+    case QMetaType::Double:
+        return qHash(value.toDouble(), seed);
+    case QMetaType::QString:
+    case QMetaType::QByteArray:
+    case QMetaType::QUrl:
+        // Also equal to the strings they convert to
+        return hashString(value.toString(), seed);
+    case QMetaType::QVariantList: {
+        quint32 hash = seed;
+        const auto list = value.toList();
+        for (const auto &item : list) {
+            hash = combineHash(hash, hashVariant(item, seed));
+        }
+        return hash;
+    }
+    case QMetaType::QVariantMap: {
+        // QVariantMap is sorted by key, so the order is stable
+        quint32 hash = seed;
+        const auto map = value.toMap();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            hash = combineHash(hash, qHash(it.key(), seed));
+            hash = combineHash(hash, hashVariant(it.value(), seed));
+        }
+        return hash;
+    }
+    case QMetaType::QVariantHash: {
+        // Iteration order of QHash is not stable, combine in an order independent way
+        quint32 hash = seed;
+        const auto map = value.toHash();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            hash += combineHash(qHash(it.key(), seed), hashVariant(it.value(), seed));
+        }
+        return hash;
+    }
+    default:
+        break;
+    }
+
+    if (value.canConvert<QObject*>()) {
+        return qHash(value.value<QObject*>(), seed);
+    }
+    return combineHash(qHash(value.userType(), seed), qHash(value.toString(), seed));
+}
+
+quint32 ParsedRoute::hash() const
+{
+    return hashVariant(data, qHash(name));
+}
+
 ParsedRoute* parseRoute(QJSValue value)
 {
     if (value.isUndefined()) {
@@ -74,6 +216,8 @@ PageRouter::PageRouter(QQuickItem *parent) : QObject(parent), m_cache(), m_prelo
     connect(this, &PageRouter::pageStackChanged, [=]() {
         connect(m_pageStack, &ColumnView::currentIndexChanged, this, &PageRouter::currentIndexChanged);
     });
+    connect(this, &PageRouter::navigationChanged, this, &PageRouter::recordTransition);
+    CacheManager::instance()->registerCache(this);
 }
 
 QQmlListProperty<PageRoute> PageRouter::routes()
@@ -85,6 +229,9 @@ void PageRouter::appendRoute(QQmlListProperty<PageRoute>* prop, PageRoute* route
 {
     auto router = qobject_cast<PageRouter*>(prop->object);
     router->m_routes.append(route);
+    if (router->m_routeIndexReady) {
+        router->indexRoute(route);
+    }
 }
 
 int PageRouter::routeCount(QQmlListProperty<PageRoute>* prop)
@@ -103,9 +250,62 @@ void PageRouter::clearRoutes(QQmlListProperty<PageRoute>* prop)
 {
     auto router = qobject_cast<PageRouter*>(prop->object);
     router->m_routes.clear();
+    router->m_routeIndex.clear();
+}
+
+void PageRouter::indexRoute(PageRoute *route)
+{
+    if (m_routeIndex.contains(route->name())) {
+        return;
+    }
+    RouteRecord record;
+    record.component = route->component();
+    record.cache = route->cache();
+    record.cost = route->cost();
+    m_routeIndex.insert(route->name(), record);
 }
 
-PageRouter::~PageRouter() {}
+void PageRouter::rebuildRouteIndex()
+{
+    m_routeIndex.clear();
+    m_routeIndex.reserve(m_routes.size());
+    for (auto route : qAsConst(m_routes)) {
+        indexRoute(route);
+    }
+    m_routeIndexReady = true;
+}
+
+void PageRouter::registerRouteItem(ParsedRoute *route)
+{
+    auto item = route->item;
+    if (!item) {
+        return;
+    }
+    m_routeForItem.insert(item, route);
+    connect(item, &QObject::destroyed, this, [this, item]() {
+        m_routeForItem.remove(item);
+    });
+    connect(route, &QObject::destroyed, this, [this, item, route]() {
+        // Only compares the pointer, route is being destroyed
+        if (m_routeForItem.value(item) == route) {
+            m_routeForItem.remove(item);
+        }
+    });
+}
+
+PageRouter::~PageRouter()
+{
+    CacheManager::instance()->unregisterCache(this);
+    savePredictionHistory();
+    qDeleteAll(m_preloadQueue);
+    const auto incubators = m_preloadIncubators;
+    m_preloadIncubators.clear();
+    for (auto incubator : incubators) {
+        incubator->clear();
+        delete incubator->route();
+        delete incubator;
+    }
+}
 
 void PageRouter::classBegin()
 {
@@ -114,45 +314,222 @@ void PageRouter::classBegin()
 
 void PageRouter::componentComplete()
 {
+    rebuildRouteIndex();
     if (m_pageStack == nullptr) {
         qCritical() << "PageRouter should be created with a ColumnView. Not doing so is undefined behaviour, and is likely to result in a crash upon further interaction.";
     } else {
         Q_EMIT pageStackChanged();
         m_currentRoutes.clear();
         push(parseRoute(initialRoute()));
+        recordTransition();
     }
 }
 
-bool PageRouter::routesContainsKey(const QString &key) const
+void PageRouter::setPredictivePreloading(bool predictivePreloading)
 {
-    for (auto route : m_routes) {
-        if (route->name() == key) return true;
+    if (m_predictivePreloading == predictivePreloading) {
+        return;
     }
-    return false;
+    m_predictivePreloading = predictivePreloading;
+    if (!predictivePreloading) {
+        m_lastRouteName.clear();
+        m_predictedRoutes.clear();
+    }
+    Q_EMIT predictivePreloadingChanged();
 }
 
-QQmlComponent* PageRouter::routesValueForKey(const QString &key) const
+void PageRouter::setMaximumPredictedRoutes(int maximum)
 {
-    for (auto route : m_routes) {
-        if (route->name() == key) return route->component();
+    maximum = qMax(0, maximum);
+    if (m_maximumPredictedRoutes == maximum) {
+        return;
     }
-    return nullptr;
+    m_maximumPredictedRoutes = maximum;
+    Q_EMIT maximumPredictedRoutesChanged();
 }
 
-bool PageRouter::routesCacheForKey(const QString &key) const
+void PageRouter::setPredictionHistoryName(const QString &name)
+{
+    if (m_predictionHistoryName == name) {
+        return;
+    }
+    savePredictionHistory();
+    m_transitions.clear();
+    m_predictionHistoryName = name;
+    loadPredictionHistory();
+    Q_EMIT predictionHistoryNameChanged();
+}
+
+QVariantMap PageRouter::predictionStatistics() const
 {
-    for (auto route : m_routes) {
-        if (route->name() == key) return route->cache();
+    int transitions = 0;
+    for (const auto &targets : m_transitions) {
+        transitions += targets.size();
     }
-    return false;
+    return {
+        {QStringLiteral("predictions"), m_predictions},
+        {QStringLiteral("hits"), m_predictionHits},
+        {QStringLiteral("hitRate"), m_predictions > 0 ? qreal(m_predictionHits) / m_predictions : 0.0},
+        {QStringLiteral("transitions"), transitions},
+    };
 }
 
-int PageRouter::routesCostForKey(const QString &key) const
+void PageRouter::clearPredictionHistory()
 {
-    for (auto route : m_routes) {
-        if (route->name() == key) return route->cost();
+    m_transitions.clear();
+    m_transitionsDirty = false;
+    m_predictedRoutes.clear();
+    m_predictions = 0;
+    m_predictionHits = 0;
+    const auto path = predictionHistoryPath();
+    if (!path.isEmpty()) {
+        QFile::remove(path);
+    }
+}
+
+void PageRouter::recordTransition()
+{
+    if (!m_predictivePreloading || m_currentRoutes.isEmpty()) {
+        return;
+    }
+    const auto current = m_currentRoutes.last()->name;
+    if (current == m_lastRouteName) {
+        return;
+    }
+
+    if (!m_predictedRoutes.isEmpty()) {
+        ++m_predictions;
+        if (m_predictedRoutes.contains(current)) {
+            ++m_predictionHits;
+        }
+    }
+    if (!m_lastRouteName.isEmpty()) {
+        ++m_transitions[m_lastRouteName][current];
+        m_transitionsDirty = true;
+    }
+    m_lastRouteName = current;
+
+    // Most probable next routes first
+    const auto targets = m_transitions.value(current);
+    QStringList candidates = targets.keys();
+    std::stable_sort(candidates.begin(), candidates.end(), [&targets](const QString &a, const QString &b) {
+        return targets.value(a) > targets.value(b);
+    });
+
+    m_predictedRoutes.clear();
+    // Predictions only take the room left in the preload pool, so that they
+    // never evict routes preloaded on purpose
+    int budget = m_preload.size - m_preload.totalCost();
+    for (auto queued : qAsConst(m_preloadQueue)) {
+        budget -= routesCostForKey(queued->name);
+    }
+    for (auto incubator : qAsConst(m_preloadIncubators)) {
+        budget -= routesCostForKey(incubator->route()->name);
+    }
+
+    for (const auto &name : qAsConst(candidates)) {
+        if (m_predictedRoutes.length() >= m_maximumPredictedRoutes) {
+            break;
+        }
+        if (!routesContainsKey(name) || !routesCacheForKey(name)) {
+            continue;
+        }
+
+        // Predictions don't know about data, so only data-less routes get preloaded
+        const auto key = qMakePair(name, ParsedRoute(name).hash());
+        bool available = m_cache.value(key) || m_preload.value(key) || m_preloadIncubators.contains(key);
+        for (auto currentRoute : qAsConst(m_currentRoutes)) {
+            available = available || (currentRoute->name == name && !currentRoute->data.isValid());
+        }
+        for (auto queued : qAsConst(m_preloadQueue)) {
+            available = available || (queued->name == name && !queued->data.isValid());
+        }
+        // Already there, at no extra cost
+        if (available) {
+            m_predictedRoutes << name;
+            continue;
+        }
+
+        const auto cost = routesCostForKey(name);
+        if (cost > budget) {
+            continue;
+        }
+        budget -= cost;
+        m_predictedRoutes << name;
+        preload(new ParsedRoute(name));
+    }
+}
+
+QString PageRouter::predictionHistoryPath() const
+{
+    if (m_predictionHistoryName.isEmpty()) {
+        return QString();
+    }
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+        + QStringLiteral("/kirigami/pagerouter/") + m_predictionHistoryName + QStringLiteral(".json");
+}
+
+void PageRouter::loadPredictionHistory()
+{
+    QFile file(predictionHistoryPath());
+    if (file.fileName().isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const auto history = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto from = history.begin(); from != history.end(); ++from) {
+        const auto targets = from.value().toObject();
+        for (auto to = targets.begin(); to != targets.end(); ++to) {
+            m_transitions[from.key()][to.key()] += to.value().toInt();
+        }
+    }
+}
+
+void PageRouter::savePredictionHistory()
+{
+    const auto path = predictionHistoryPath();
+    if (path.isEmpty() || !m_transitionsDirty) {
+        return;
+    }
+    QJsonObject history;
+    for (auto from = m_transitions.constBegin(); from != m_transitions.constEnd(); ++from) {
+        QJsonObject targets;
+        for (auto to = from.value().constBegin(); to != from.value().constEnd(); ++to) {
+            targets.insert(to.key(), to.value());
+        }
+        history.insert(from.key(), targets);
     }
-    return -1;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not save the navigation history to" << path;
+        return;
+    }
+    file.write(QJsonDocument(history).toJson(QJsonDocument::Compact));
+    if (file.commit()) {
+        m_transitionsDirty = false;
+    }
+}
+
+bool PageRouter::routesContainsKey(const QString &key) const
+{
+    return m_routeIndex.contains(key);
+}
+
+QQmlComponent* PageRouter::routesValueForKey(const QString &key) const
+{
+    return m_routeIndex.value(key).component;
+}
+
+bool PageRouter::routesCacheForKey(const QString &key) const
+{
+    return m_routeIndex.value(key).cache;
+}
+
+int PageRouter::routesCostForKey(const QString &key) const
+{
+    auto it = m_routeIndex.constFind(key);
+    return it != m_routeIndex.constEnd() ? it->cost : -1;
 }
 
 void PageRouter::push(ParsedRoute* route)
@@ -163,6 +540,19 @@ void PageRouter::push(ParsedRoute* route)
         return;
     }
     if (routesCacheForKey(route->name)) {
+        const auto key = qMakePair(route->name, route->hash());
+
+        // Still being preloaded: finish it now rather than creating it twice
+        if (auto incubator = m_preloadIncubators.value(key)) {
+            incubator->forceCompletion();
+        }
+        for (int i = 0; i < m_preloadQueue.length(); ++i) {
+            if (m_preloadQueue[i]->name == route->name && m_preloadQueue[i]->data == route->data) {
+                delete m_preloadQueue.takeAt(i);
+                break;
+            }
+        }
+
         auto push = [route, this](ParsedRoute* item) {
             m_currentRoutes << item;
 
@@ -170,18 +560,20 @@ void PageRouter::push(ParsedRoute* route)
                 item->item->setProperty(qUtf8Printable(it.key()), it.value());
             }
 
-            m_pageStack->addItem(item->item);
+            addToPageStack(item->item);
         };
-        auto item = m_cache.take(qMakePair(route->name, route->hash()));
-        if (item && item->item) {
+        auto item = m_cache.take(key);
+        if (item && item->item && item->data == route->data) {
             push(item);
             return;
         }
-        item = m_preload.take(qMakePair(route->name, route->hash()));
-        if (item && item->item) {
+        delete item;
+        item = m_preload.take(key);
+        if (item && item->item && item->data == route->data) {
             push(item);
             return;
         }
+        delete item;
     }
     auto context = qmlContext(this);
     auto component = routesValueForKey(route->name);
@@ -200,12 +592,14 @@ void PageRouter::push(ParsedRoute* route)
         }
         route->setItem(qqItem);
         route->cache = routesCacheForKey(route->name);
+        registerRouteItem(route);
         m_currentRoutes << route;
         auto attached = qobject_cast<PageRouterAttached*>(qmlAttachedPropertiesObject<PageRouter>(item, true));
         attached->m_router = this;
         component->completeCreate();
-        m_pageStack->addItem(qqItem);
-        m_pageStack->setCurrentIndex(m_currentRoutes.length()-1);
+        if (addToPageStack(qqItem)) {
+            m_pageStack->setCurrentIndex(m_currentRoutes.length()-1);
+        }
     };
 
     if (component->status() == QQmlComponent::Ready) {
@@ -233,44 +627,65 @@ void PageRouter::setInitialRoute(QJSValue value)
     m_initialRoute = value;
 }
 
+bool PageRouter::addToPageStack(QQuickItem *item)
+{
+    if (m_batchNavigation) {
+        m_batchedItems << item;
+        return false;
+    }
+    m_pageStack->addItem(item);
+    return true;
+}
+
 void PageRouter::navigateToRoute(QJSValue route)
 {
     auto incomingRoutes = parseRoutes(route);
-    QList<ParsedRoute*> resolvedRoutes;
 
-    if (incomingRoutes.length() <= m_currentRoutes.length()) {
-        resolvedRoutes = m_currentRoutes.mid(0, incomingRoutes.length());
-    } else {
-        resolvedRoutes = m_currentRoutes;
-        resolvedRoutes.reserve(incomingRoutes.length()-m_currentRoutes.length());
-    }
-
-    for (int i = 0; i < incomingRoutes.length(); i++) {
-        auto incoming = incomingRoutes.at(i);
-        Q_ASSERT(incoming);
-        if (i >= resolvedRoutes.length()) {
-            resolvedRoutes.append(incoming);
-        } else { 
-            auto current = resolvedRoutes.value(i);
-            Q_ASSERT(current);
-            if (current->name != incoming->name || current->data != incoming->data) {
-                resolvedRoutes.replace(i, incoming);
-            }
+    // The routes in the common prefix stay in place, untouched
+    int common = 0;
+    while (common < incomingRoutes.length() && common < m_currentRoutes.length()) {
+        auto current = m_currentRoutes.at(common);
+        auto incoming = incomingRoutes.at(common);
+        Q_ASSERT(current && incoming);
+        if (current->name != incoming->name || current->data != incoming->data) {
+            break;
         }
+        ++common;
     }
 
-    for (const auto &route : qAsConst(m_currentRoutes)) {
-        if (!resolvedRoutes.contains(route)) {
-            placeInCache(route);
-        }
+    const int previousLength = m_currentRoutes.length();
+    if (common == previousLength && common == incomingRoutes.length()) {
+        qDeleteAll(incomingRoutes);
+        return;
+    }
+
+    for (int i = 0; i < common; ++i) {
+        delete incomingRoutes.at(i);
+    }
+
+    // Pop only the divergent suffix
+    while (m_currentRoutes.length() > common) {
+        auto toPop = m_currentRoutes.takeLast();
+        m_pageStack->removeItem(toPop->item);
+        placeInCache(toPop);
+    }
+
+    // And push the new routes, laying out the ColumnView only once
+    m_batchNavigation = true;
+    for (int i = common; i < incomingRoutes.length(); ++i) {
+        push(incomingRoutes.at(i));
     }
+    m_batchNavigation = false;
 
-    m_pageStack->clear();
-    m_currentRoutes.clear();
-    for (auto toPush : qAsConst(resolvedRoutes)) {
-        push(toPush);
+    if (!m_batchedItems.isEmpty()) {
+        m_pageStack->insertItems(m_pageStack->count(), m_batchedItems);
+        m_batchedItems.clear();
+    }
+    if (!m_currentRoutes.isEmpty()) {
+        m_pageStack->setCurrentIndex(m_currentRoutes.length()-1);
     }
-    Q_EMIT navigationChanged();
+
+    Q_EMIT navigationChanged(common, qMax(previousLength, m_currentRoutes.length()) - 1);
 }
 
 void PageRouter::bringToView(QJSValue route)
@@ -313,47 +728,33 @@ bool PageRouter::routeActive(QJSValue route)
 
 void PageRouter::pushRoute(QJSValue route)
 {
+    const int index = m_currentRoutes.length();
     push(parseRoute(route));
-    Q_EMIT navigationChanged();
+    Q_EMIT navigationChanged(index, index);
 }
 
 void PageRouter::popRoute()
 {
+    const int index = m_currentRoutes.length() - 1;
     m_pageStack->pop(m_currentRoutes.last()->item);
     placeInCache(m_currentRoutes.last());
     m_currentRoutes.removeLast();
-    Q_EMIT navigationChanged();
+    Q_EMIT navigationChanged(index, index);
 }
 
 QVariant PageRouter::dataFor(QObject *object)
 {
     auto pointer = object;
     auto qqiPointer = qobject_cast<QQuickItem*>(object);
-    QHash<QQuickItem*,ParsedRoute*> routes;
-    for (auto route : qAsConst(m_cache.items)) {
-        routes[route->item] = route;
-    }
-    for (auto route : qAsConst(m_preload.items)) {
-        routes[route->item] = route;
-    }
-    for (auto route : qAsConst(m_currentRoutes)) {
-        routes[route->item] = route;
-    }
     while (qqiPointer != nullptr) {
-        const auto keys = routes.keys();
-        for (auto item : keys) {
-            if (item == qqiPointer) {
-                return routes[item]->data;
-            }
+        if (auto route = m_routeForItem.value(qqiPointer)) {
+            return route->data;
         }
         qqiPointer = qqiPointer->parentItem();
     }
     while (pointer != nullptr) {
-        const auto keys = routes.keys();
-        for (auto item : keys) {
-            if (item == pointer) {
-                return routes[item]->data;
-            }
+        if (auto route = m_routeForItem.value(qobject_cast<QQuickItem*>(pointer))) {
+            return route->data;
         }
         pointer = pointer->parent();
     }
@@ -364,12 +765,11 @@ bool PageRouter::isActive(QObject *object)
 {
     auto pointer = object;
     while (pointer != nullptr) {
-        auto index = 0;
-        for (auto route : qAsConst(m_currentRoutes)) {
-            if (route->item == pointer) {
-                return m_pageStack->currentIndex() == index;
-            }
-            index++;
+        auto route = m_routeForItem.value(qobject_cast<QQuickItem*>(pointer));
+        if (route && m_currentRoutes.value(m_pageStack->currentIndex()) == route) {
+            return true;
+        } else if (route && m_currentRoutes.contains(route)) {
+            return false;
         }
         pointer = pointer->parent();
     }
@@ -377,6 +777,33 @@ bool PageRouter::isActive(QObject *object)
     return false;
 }
 
+QString PageRouter::cacheName() const
+{
+    return objectName().isEmpty() ? QStringLiteral("PageRouter") : QStringLiteral("PageRouter ") + objectName();
+}
+
+int PageRouter::cachePriority() const
+{
+    // Preloaded routes are speculative, so this goes first
+    return 0;
+}
+
+qint64 PageRouter::cacheCost() const
+{
+    return m_cache.totalSize + m_preload.totalSize;
+}
+
+int PageRouter::cacheCount() const
+{
+    return m_cache.count() + m_preload.count();
+}
+
+void PageRouter::trimCache(qint64 maximumCost)
+{
+    m_preload.pruneToSize(qMax<qint64>(0, maximumCost - m_cache.totalSize));
+    m_cache.pruneToSize(maximumCost - m_preload.totalSize);
+}
+
 PageRouterAttached* PageRouter::qmlAttachedProperties(QObject *object)
 {
     auto attached = new PageRouterAttached(object);
@@ -425,8 +852,15 @@ QSet<QObject*> flatParentTree(QObject* object)
 
 void PageRouter::preload(ParsedRoute* route)
 {
-    for (auto preloaded : qAsConst(m_preload.items)) {
-        if (preloaded->equals(route)) {
+    const auto key = qMakePair(route->name, route->hash());
+    auto preloaded = m_preload.value(key);
+    if ((preloaded && preloaded->name == route->name && preloaded->data == route->data)
+        || m_preloadIncubators.contains(key)) {
+        delete route;
+        return;
+    }
+    for (auto queued : qAsConst(m_preloadQueue)) {
+        if (queued->name == route->name && queued->data == route->data) {
             delete route;
             return;
         }
@@ -436,59 +870,97 @@ void PageRouter::preload(ParsedRoute* route)
         delete route;
         return;
     }
+    if (!routesCacheForKey(route->name)) {
+        qCritical() << "Route" << route->name << "is being preloaded despite it not having caching enabled.";
+        delete route;
+        return;
+    }
+
+    m_preloadQueue << route;
+    // Give way to whatever the user is doing right now
+    QTimer::singleShot(0, this, &PageRouter::processPreloadQueue);
+}
+
+void PageRouter::processPreloadQueue()
+{
+    // Preloads are incubated one at a time so they never compete with each other,
+    // and only in the time left in each frame by the incubation controller
+    if (!m_preloadIncubators.isEmpty() || m_preloadQueue.isEmpty()) {
+        return;
+    }
+
+    auto route = m_preloadQueue.takeFirst();
     auto context = qmlContext(this);
     auto component = routesValueForKey(route->name);
-    auto createAndCache = [component, context, route, this]() {
-        auto item = component->beginCreate(context);
-        item->setParent(this);
-        auto qqItem = qobject_cast<QQuickItem*>(item);
-        if (!qqItem) {
-            qCritical() << "Route" << route->name << "is not an item! This is undefined behaviour and will likely crash your application.";
-        }
-        for ( auto it = route->properties.begin(); it != route->properties.end(); it++ ) {
-            qqItem->setProperty(qUtf8Printable(it.key()), it.value());
-        }
-        route->setItem(qqItem);
-        route->cache = routesCacheForKey(route->name);
-        auto attached = qobject_cast<PageRouterAttached*>(qmlAttachedPropertiesObject<PageRouter>(item, true));
-        attached->m_router = this;
-        component->completeCreate();
-        if (!route->cache) {
-            qCritical() << "Route" << route->name << "is being preloaded despite it not having caching enabled.";
-            delete route;
-            return;
-        }
-        auto string = route->name;
-        auto hash = route->hash();
-        m_preload.insert(qMakePair(string, hash), route, routesCostForKey(route->name));
+
+    auto incubate = [component, context, route, this]() {
+        auto incubator = new PreloadIncubator(this, route);
+        m_preloadIncubators.insert(qMakePair(route->name, route->hash()), incubator);
+        component->create(*incubator, context);
     };
 
     if (component->status() == QQmlComponent::Ready) {
-        createAndCache();
+        incubate();
     } else if (component->status() == QQmlComponent::Loading) {
-        connect(component, &QQmlComponent::statusChanged, [=](QQmlComponent::Status status) {
+        connect(component, &QQmlComponent::statusChanged, this, [=](QQmlComponent::Status status) {
+            disconnect(component, &QQmlComponent::statusChanged, this, nullptr);
             // Loading can only go to Ready or Error.
             if (status != QQmlComponent::Ready) {
-                qCritical() << "Failed to push route:" << component->errors();
+                qCritical() << "Failed to preload route:" << component->errors();
+                delete route;
+                processPreloadQueue();
+                return;
             }
-            createAndCache();
+            incubate();
         });
     } else {
-        qCritical() << "Failed to push route:" << component->errors();
+        qCritical() << "Failed to preload route:" << component->errors();
+        delete route;
+        processPreloadQueue();
     }
 }
 
+void PageRouter::preloadIncubated(PreloadIncubator *incubator, QQmlIncubator::Status status)
+{
+    auto route = incubator->route();
+    m_preloadIncubators.remove(qMakePair(route->name, route->hash()));
+
+    if (status == QQmlIncubator::Ready) {
+        m_preload.insert(qMakePair(route->name, route->hash()), route, routesCostForKey(route->name));
+        CacheManager::instance()->cacheChanged(this);
+    } else {
+        qCritical() << "Failed to preload route:" << incubator->errors();
+        delete route;
+    }
+
+    // Deleting the incubator from within its own statusChanged() is not safe
+    QTimer::singleShot(0, [incubator]() {
+        delete incubator;
+    });
+    QTimer::singleShot(0, this, &PageRouter::processPreloadQueue);
+}
+
 void PageRouter::unpreload(ParsedRoute* route)
 {
-    ParsedRoute* toDelete = nullptr;
-    for (auto preloaded : qAsConst(m_preload.items)) {
-        if (preloaded->equals(route)) {
-            toDelete = preloaded;
+    const auto key = qMakePair(route->name, route->hash());
+
+    for (int i = 0; i < m_preloadQueue.length(); ++i) {
+        if (m_preloadQueue[i]->name == route->name && m_preloadQueue[i]->data == route->data) {
+            delete m_preloadQueue.takeAt(i);
+            break;
         }
     }
-    if (toDelete != nullptr) {
-        m_preload.take(qMakePair(toDelete->name, toDelete->hash()));
-        delete toDelete;
+    if (auto incubator = m_preloadIncubators.take(key)) {
+        // Aborts the incubation and deletes the partially created item
+        incubator->clear();
+        delete incubator->route();
+        delete incubator;
+        QTimer::singleShot(0, this, &PageRouter::processPreloadQueue);
+    }
+
+    auto preloaded = m_preload.value(key);
+    if (preloaded && preloaded->name == route->name && preloaded->data == route->data) {
+        delete m_preload.take(key);
     }
     delete route;
 }
@@ -660,6 +1132,7 @@ void PageRouter::placeInCache(ParsedRoute *route)
     auto string = route->name;
     auto hash = route->hash();
     m_cache.insert(qMakePair(string, hash), route, routesCostForKey(route->name));
+    CacheManager::instance()->cacheChanged(this);
 }
 
 void PageRouter::pushFromObject(QObject *object, QJSValue inputRoute, bool replace)
@@ -667,8 +1140,11 @@ void PageRouter::pushFromObject(QObject *object, QJSValue inputRoute, bool repla
     const auto parsed = parseRoutes(inputRoute);
     const auto objects = flatParentTree(object);
 
+    const int previousLength = m_currentRoutes.length();
+
     for (const auto& obj : objects) {
         bool popping = false;
+        int firstChanged = 0;
         for (auto route : qAsConst(m_currentRoutes)) {
             if (popping) {
                 m_currentRoutes.removeAll(route);
@@ -676,6 +1152,7 @@ void PageRouter::pushFromObject(QObject *object, QJSValue inputRoute, bool repla
                 continue;
             }
             if (route->item == obj) {
+                firstChanged = m_currentRoutes.indexOf(route) + (replace ? 0 : 1);
                 m_pageStack->pop(route->item);
                 if (replace) {
                     m_currentRoutes.removeAll(route);
@@ -690,7 +1167,7 @@ void PageRouter::pushFromObject(QObject *object, QJSValue inputRoute, bool repla
                     push(route);
                 }
             }
-            Q_EMIT navigationChanged();
+            Q_EMIT navigationChanged(firstChanged, qMax(previousLength, m_currentRoutes.length()) - 1);
             return;
         }
     }
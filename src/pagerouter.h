@@ -7,11 +7,12 @@
 #pragma once
 
 #include <QCache>
+#include <QQmlIncubator>
 #include <QQuickItem>
-#include <QRandomGenerator>
+#include "cachemanager.h"
 #include "columnview.h"
+#include "costlru.h"
 
-static std::map<quint32,QVariant> s_knownVariants;
 class PageRouter;
 
 class ParsedRoute : public QObject {
@@ -46,19 +47,11 @@ public:
             item->deleteLater();
         }
     }
-    quint32 hash() {
-        for (auto i = s_knownVariants.begin(); i != s_knownVariants.end(); i++) {
-            if (i->second == data) {
-                return i->first;
-            }
-        }
-        auto number = QRandomGenerator::system()->generate();
-        while (s_knownVariants.count(number) > 0) {
-            number = QRandomGenerator::system()->generate();
-        }
-        s_knownVariants[number] = data;
-        return number;
-    }
+    /**
+     * A structural hash of name and data: routes with equal
+     * name and data always have the same hash.
+     */
+    quint32 hash() const;
     bool equals(const ParsedRoute* rhs, bool countItem = false)
     {
         return name == rhs->name &&
@@ -68,21 +61,50 @@ public:
     }
 };
 
+/**
+ * A cost based LRU cache of ParsedRoutes.
+ *
+ * The recency order is a CostLru, so that every operation is O(1).
+ * The cache owns the ParsedRoutes it holds. Their estimated sizes in
+ * bytes, for CacheManager, are measured once on insertion.
+ */
 struct LRU {
+    using Key = QPair<QString,quint32>;
+
     int size = 10;
-    QList<QPair<QString,quint32>> evictionList;
-    QMap<QPair<QString,quint32>,int> costs;
-    QMap<QPair<QString,quint32>,ParsedRoute*> items;
+    CostLru<Key> order;
+    QHash<Key,ParsedRoute*> routes;
+    QHash<Key,qint64> sizes;
+    qint64 totalSize = 0;
+
+    LRU() = default;
+    ~LRU() {
+        qDeleteAll(routes);
+    }
+    Q_DISABLE_COPY(LRU)
 
-    ParsedRoute* take(QPair<QString,quint32> key) {
-        auto ret = items.take(key);
-        evictionList.removeAll(key);
-        return ret;
+    int totalCost() const {
+        return order.totalCost();
+    }
+    int count() const {
+        return routes.count();
+    }
+    ParsedRoute* take(const Key &key) {
+        auto item = routes.take(key);
+        if (item) {
+            order.remove(key);
+            totalSize -= sizes.take(key);
+        }
+        return item;
     }
-    int totalCosts() {
-        int ret = 0;
-        for (auto cost : qAsConst(costs)) {
-            ret += cost;
+    ParsedRoute* value(const Key &key) const {
+        return routes.value(key);
+    }
+    QList<ParsedRoute*> items() const {
+        QList<ParsedRoute*> ret;
+        ret.reserve(routes.size());
+        for (auto node = order.first(); node; node = node->next) {
+            ret << routes.value(node->key);
         }
         return ret;
     }
@@ -91,30 +113,34 @@ struct LRU {
         prune();
     }
     void prune() {
-        while (size < totalCosts()) {
-            auto key = evictionList.last();
-            auto item = items.take(key);
-            delete item;
-            costs.take(key);
-            evictionList.takeLast();
+        pruneTo(size);
+    }
+    void pruneTo(int maximumCost) {
+        while (maximumCost < order.totalCost() && order.last()) {
+            delete take(order.last()->key);
         }
     }
-    void insert(QPair<QString,quint32> key, ParsedRoute *newItem, int cost) {
-        if (items.contains(key)) {
-            auto item = items.take(key);
-            evictionList.removeAll(key);
-            if (item != newItem) {
-                delete item;
-            }
+    void pruneToSize(qint64 maximumSize) {
+        while (maximumSize < totalSize && order.last()) {
+            delete take(order.last()->key);
         }
-        costs[key] = cost;
-        items[key] = newItem;
-        evictionList.prepend(key);
+    }
+    void insert(const Key &key, ParsedRoute *newItem, int cost) {
+        auto item = take(key);
+        if (item != newItem) {
+            delete item;
+        }
+        routes.insert(key, newItem);
+        order.touch(key, cost);
+        const qint64 size = CacheManager::estimateSize(newItem->item);
+        sizes.insert(key, size);
+        totalSize += size;
         prune();
     }
 };
 
 class PageRouterAttached;
+class PreloadIncubator;
 
 /**
  * Item holding data about when to preload a route.
@@ -144,7 +170,7 @@ class PreloadRouteGroup : public QObject
      * When the condition is false, the route will not be preloaded.
      */
     Q_PROPERTY(bool when MEMBER m_when NOTIFY changed)
-    bool m_when;
+    bool m_when = false;
 
     void handleChange();
     PageRouterAttached* m_parent;
@@ -294,7 +320,7 @@ public:
  * @see PageRouterAttached
  * @see PageRoute
  */
-class PageRouter : public QObject, public QQmlParserStatus
+class PageRouter : public QObject, public QQmlParserStatus, public ManagedCache
 {
     Q_OBJECT
     Q_INTERFACES(QQmlParserStatus)
@@ -348,6 +374,46 @@ class PageRouter : public QObject, public QQmlParserStatus
      */
     Q_PROPERTY(int preloadedPoolCapacity READ preloadedPoolCapacity WRITE setPreloadedPoolCapacity)
 
+    /**
+     * @brief Whether to preload routes based on navigation history.
+     *
+     * When enabled, the PageRouter records which route the user navigates to
+     * from each route and preloads the most probable next routes, within the
+     * room left in the preloaded pool, so that predictions never evict routes
+     * preloaded explicitly. Only routes with caching enabled can be predicted.
+     *
+     * Defaults to false.
+     *
+     * @see predictionStatistics
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_PROPERTY(bool predictivePreloading READ predictivePreloading WRITE setPredictivePreloading NOTIFY predictivePreloadingChanged)
+
+    /**
+     * @brief The maximum number of routes preloaded after each navigation
+     * when predictivePreloading is enabled.
+     *
+     * Defaults to 2.
+     *
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_PROPERTY(int maximumPredictedRoutes READ maximumPredictedRoutes WRITE setMaximumPredictedRoutes NOTIFY maximumPredictedRoutesChanged)
+
+    /**
+     * @brief The name under which the navigation history is persisted.
+     *
+     * If set, the recorded transitions are loaded from and saved to the
+     * application's data location, so that predictions survive restarts.
+     * Every PageRouter of an application should use a different name.
+     * If empty, the history only lives as long as the PageRouter.
+     *
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_PROPERTY(QString predictionHistoryName READ predictionHistoryName WRITE setPredictionHistoryName NOTIFY predictionHistoryNameChanged)
+
 private:
     /**
      * @brief The routes the PageRouter is aware of.
@@ -403,6 +469,57 @@ private:
      */
     void push(ParsedRoute* route);
 
+    /**
+     * @brief Adds the item of a pushed route to the ColumnView.
+     *
+     * While navigateToRoute is pushing routes, the items are collected
+     * and added all at once at the end instead.
+     *
+     * @returns true if the item was added immediately.
+     */
+    bool addToPageStack(QQuickItem *item);
+
+    /**
+     * @brief Whether navigateToRoute is currently pushing routes.
+     */
+    bool m_batchNavigation = false;
+
+    /**
+     * @brief Items pushed during navigateToRoute, not yet in the ColumnView.
+     */
+    QList<QQuickItem*> m_batchedItems;
+
+    /**
+     * @brief What the PageRouter needs to know about a PageRoute.
+     */
+    struct RouteRecord {
+        QQmlComponent *component = nullptr;
+        bool cache = false;
+        int cost = 1;
+    };
+
+    /**
+     * @brief m_routes indexed by name.
+     *
+     * Built on componentComplete, when the PageRoutes have their
+     * properties set, and kept up to date by appendRoute and clearRoutes
+     * afterwards. As with the list, the first route with a name wins.
+     */
+    QHash<QString,RouteRecord> m_routeIndex;
+    bool m_routeIndexReady = false;
+    void indexRoute(PageRoute *route);
+    void rebuildRouteIndex();
+
+    /**
+     * @brief The route of every item created by the PageRouter.
+     *
+     * A ParsedRoute keeps its item while moving between m_currentRoutes,
+     * m_cache and m_preload, so this only changes when items are created
+     * or destroyed.
+     */
+    QHash<QQuickItem*,ParsedRoute*> m_routeForItem;
+    void registerRouteItem(ParsedRoute *route);
+
     /**
      * @brief Helper function to access whether m_routes has a key.
      * 
@@ -434,8 +551,55 @@ private:
      */
     int routesCostForKey(const QString &key) const;
 
+    /**
+     * @brief Queues a route to be preloaded.
+     *
+     * Preloaded routes are created asynchronously with a QQmlIncubator,
+     * one at a time, so they don't cause the jank they are meant to avoid.
+     */
     void preload(ParsedRoute *route);
     void unpreload(ParsedRoute *route);
+    void processPreloadQueue();
+    void preloadIncubated(PreloadIncubator *incubator, QQmlIncubator::Status status);
+
+    /**
+     * @brief Routes waiting to be preloaded, in order.
+     */
+    QList<ParsedRoute*> m_preloadQueue;
+
+    /**
+     * @brief Routes being preloaded right now.
+     *
+     * A push of one of these routes forces the completion of its incubation
+     * instead of creating a second item.
+     */
+    QHash<LRU::Key,PreloadIncubator*> m_preloadIncubators;
+
+    /**
+     * @brief Records a transition to the current route and preloads
+     * the most probable next routes.
+     */
+    void recordTransition();
+    QString predictionHistoryPath() const;
+    void loadPredictionHistory();
+    void savePredictionHistory();
+
+    bool m_predictivePreloading = false;
+    int m_maximumPredictedRoutes = 2;
+    QString m_predictionHistoryName;
+
+    /**
+     * @brief How many times each route was navigated to from another one.
+     *
+     * A first-order Markov model: m_transitions[from][to] is the number of
+     * times the user went from route @c from to route @c to.
+     */
+    QHash<QString, QHash<QString,int>> m_transitions;
+    bool m_transitionsDirty = false;
+    QString m_lastRouteName;
+    QStringList m_predictedRoutes;
+    int m_predictions = 0;
+    int m_predictionHits = 0;
 
     void placeInCache(ParsedRoute *route);
 
@@ -451,6 +615,7 @@ private:
     friend class PageRouterAttached;
     friend class PreloadRouteGroup;
     friend class ParsedRoute;
+    friend class PreloadIncubator;
 
 protected:
     void classBegin() override;
@@ -471,11 +636,46 @@ public:
     int preloadedPoolCapacity() const { return m_preload.size; };
     void setPreloadedPoolCapacity(int size) { m_preload.setSize(size); };
 
+    bool predictivePreloading() const { return m_predictivePreloading; };
+    void setPredictivePreloading(bool predictivePreloading);
+
+    int maximumPredictedRoutes() const { return m_maximumPredictedRoutes; };
+    void setMaximumPredictedRoutes(int maximum);
+
+    QString predictionHistoryName() const { return m_predictionHistoryName; };
+    void setPredictionHistoryName(const QString &name);
+
+    /**
+     * @brief Returns how well predictivePreloading is doing.
+     *
+     * The returned map has the following keys:
+     * * `predictions`: how many navigations happened while routes were predicted
+     * * `hits`: how many of those navigations went to a predicted route
+     * * `hitRate`: hits divided by predictions, 0 if there were no predictions
+     * * `transitions`: how many distinct route to route transitions are known
+     *
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_INVOKABLE QVariantMap predictionStatistics() const;
+
+    /**
+     * @brief Forgets the recorded navigation history and the statistics,
+     * including the persisted history if any.
+     *
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_INVOKABLE void clearPredictionHistory();
+
     /**
      * @brief Navigate to the given route.
      * 
      * Calling `navigateToRoute` causes the PageRouter to replace currently
      * active pages with the new route.
+     *
+     * Pages in the common prefix of the current and the new route are left
+     * in place; only the routes after it are popped and the new ones pushed.
      * 
      * @param route The given route for the PageRouter to navigate to.
      * A route is an array of variants or a single item. A string item will be interpreted
@@ -597,12 +797,30 @@ public:
 
     static PageRouterAttached *qmlAttachedProperties(QObject *object);
 
+    // ManagedCache, covering both the cache and the preloaded pool
+    QString cacheName() const override;
+    int cachePriority() const override;
+    qint64 cacheCost() const override;
+    int cacheCount() const override;
+    void trimCache(qint64 maximumCost) override;
+
 Q_SIGNALS:
     void routesChanged();
     void initialRouteChanged();
     void pageStackChanged();
     void currentIndexChanged();
-    void navigationChanged();
+
+    /**
+     * @brief Emitted once per navigation.
+     *
+     * Routes before @p firstChangedIndex were left untouched; routes from
+     * @p firstChangedIndex to @p lastChangedIndex included have been popped,
+     * pushed or replaced.
+     */
+    void navigationChanged(int firstChangedIndex, int lastChangedIndex);
+    void predictivePreloadingChanged();
+    void maximumPredictedRoutesChanged();
+    void predictionHistoryNameChanged();
 };
 
 /**
@@ -658,6 +876,7 @@ private:
     friend class PageRouter;
     friend class PreloadRouteGroup;
     friend class ParsedRoute;
+    friend class PreloadIncubator;
 
 public:
     PreloadRouteGroup* preload() const { return m_preload; };
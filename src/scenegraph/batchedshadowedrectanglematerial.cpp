@@ -0,0 +1,114 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "batchedshadowedrectanglematerial.h"
+
+#include <QOpenGLContext>
+
+QSGMaterialType BatchedShadowedRectangleMaterial::staticType;
+QSGMaterialType BatchedShadowedRectangleMaterial::lowPowerType;
+
+QSGMaterialShader* BatchedShadowedRectangleMaterial::createShader() const
+{
+    return new BatchedShadowedRectangleShader{shaderType, QStringLiteral("shadowedrectangle")};
+}
+
+QSGMaterialType* BatchedShadowedRectangleMaterial::type() const
+{
+    return shaderType == ShaderType::LowPower ? &lowPowerType : &staticType;
+}
+
+int BatchedShadowedRectangleMaterial::compare(const QSGMaterial *other) const
+{
+    // Everything else is in the vertices
+    auto material = static_cast<const BatchedShadowedRectangleMaterial *>(other);
+    return int(shaderType) - int(material->shaderType);
+}
+
+QSGMaterialType BatchedShadowedBorderRectangleMaterial::staticType;
+QSGMaterialType BatchedShadowedBorderRectangleMaterial::lowPowerType;
+
+QSGMaterialShader* BatchedShadowedBorderRectangleMaterial::createShader() const
+{
+    return new BatchedShadowedRectangleShader{shaderType, QStringLiteral("shadowedborderrectangle")};
+}
+
+QSGMaterialType* BatchedShadowedBorderRectangleMaterial::type() const
+{
+    return shaderType == ShaderType::LowPower ? &lowPowerType : &staticType;
+}
+
+int BatchedShadowedBorderRectangleMaterial::compare(const QSGMaterial *other) const
+{
+    auto material = static_cast<const BatchedShadowedBorderRectangleMaterial *>(other);
+    return int(shaderType) - int(material->shaderType);
+}
+
+BatchedShadowedRectangleShader::BatchedShadowedRectangleShader(ShadowedRectangleMaterial::ShaderType shaderType, const QString &shader)
+{
+    auto header = QOpenGLContext::currentContext()->isOpenGLES() ? QStringLiteral("header_es.glsl") : QStringLiteral("header_desktop.glsl");
+
+    auto shaderRoot = QStringLiteral(":/org/kde/kirigami/shaders/");
+
+    setShaderSourceFiles(QOpenGLShader::Vertex, {
+        shaderRoot + header,
+        shaderRoot + QStringLiteral("shadowedrectangle_batched.vert")
+    });
+
+    QString shaderFile = shader + QStringLiteral(".frag");
+    auto sdfFile = QStringLiteral("sdf.glsl");
+    if (shaderType == ShadowedRectangleMaterial::ShaderType::LowPower) {
+        shaderFile = shader + QStringLiteral("_lowpower.frag");
+        sdfFile = QStringLiteral("sdf_lowpower.glsl");
+    }
+
+    // The very same fragment shaders as the unbatched materials, so that they look the same
+    setShaderSourceFiles(QOpenGLShader::Fragment, {
+        shaderRoot + header,
+        shaderRoot + QStringLiteral("batched.glsl"),
+        shaderRoot + sdfFile,
+        shaderRoot + shaderFile
+    });
+}
+
+const char *const * BatchedShadowedRectangleShader::attributeNames() const
+{
+    // In the order of BatchedShadowedRectangleNode's vertex attributes
+    static char const *const names[] = {
+        "in_vertex",
+        "in_uv_size_border_width",
+        "in_aspect_offset",
+        "in_radius",
+        "in_color",
+        "in_shadow_color",
+        "in_border_color",
+        nullptr
+    };
+    return names;
+}
+
+void BatchedShadowedRectangleShader::initialize()
+{
+    QSGMaterialShader::initialize();
+    m_matrixLocation = program()->uniformLocation("matrix");
+    m_opacityLocation = program()->uniformLocation("opacity");
+}
+
+void BatchedShadowedRectangleShader::updateState(const QSGMaterialShader::RenderState& state, QSGMaterial* newMaterial, QSGMaterial* oldMaterial)
+{
+    Q_UNUSED(newMaterial)
+    Q_UNUSED(oldMaterial)
+
+    auto p = program();
+
+    if (state.isMatrixDirty()) {
+        p->setUniformValue(m_matrixLocation, state.combinedMatrix());
+    }
+
+    if (state.isOpacityDirty()) {
+        p->setUniformValue(m_opacityLocation, state.opacity());
+    }
+}
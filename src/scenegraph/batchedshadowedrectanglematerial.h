@@ -0,0 +1,59 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include "shadowedborderrectanglematerial.h"
+
+/**
+ * A version of ShadowedRectangleMaterial whose parameters are vertex attributes.
+ *
+ * Every rectangle using this material has the same material state, so the
+ * scene graph renderer can merge rectangles of different colors, radii and
+ * shadows into a single draw call. BatchedShadowedRectangleNode writes the
+ * parameters of the material in its vertices.
+ */
+class BatchedShadowedRectangleMaterial : public ShadowedRectangleMaterial
+{
+public:
+    QSGMaterialShader* createShader() const override;
+    QSGMaterialType* type() const override;
+    int compare(const QSGMaterial* other) const override;
+
+    static QSGMaterialType staticType;
+    static QSGMaterialType lowPowerType;
+};
+
+/**
+ * A version of ShadowedBorderRectangleMaterial whose parameters are vertex attributes.
+ *
+ * \sa BatchedShadowedRectangleMaterial
+ */
+class BatchedShadowedBorderRectangleMaterial : public ShadowedBorderRectangleMaterial
+{
+public:
+    QSGMaterialShader* createShader() const override;
+    QSGMaterialType* type() const override;
+    int compare(const QSGMaterial* other) const override;
+
+    static QSGMaterialType staticType;
+    static QSGMaterialType lowPowerType;
+};
+
+class BatchedShadowedRectangleShader : public QSGMaterialShader
+{
+public:
+    BatchedShadowedRectangleShader(ShadowedRectangleMaterial::ShaderType shaderType, const QString &shader);
+
+    char const *const *attributeNames() const override;
+
+    void initialize() override;
+    void updateState(const QSGMaterialShader::RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial) override;
+
+private:
+    int m_matrixLocation = -1;
+    int m_opacityLocation = -1;
+};
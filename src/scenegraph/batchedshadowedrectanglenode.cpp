@@ -0,0 +1,196 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "batchedshadowedrectanglenode.h"
+#include "batchedshadowedrectanglematerial.h"
+
+#include <QSGFlatColorMaterial>
+#include <QVector>
+
+#include <algorithm>
+
+// Below this size the interior isn't worth a node of its own
+static const qreal s_minimumInteriorSize = 32.0;
+// Keeps the interior away from the antialiased edges
+static const qreal s_interiorMargin = 2.0;
+
+// Matches the attributes of BatchedShadowedRectangleShader. OpenGL ES 2 only
+// guarantees 8 vertex attributes, and the batch renderer of Qt Quick adds one
+// of its own, _qt_order, to merged opaque geometry: the parameters are thus
+// packed into 7 attributes.
+struct BatchedVertex
+{
+    float x, y;
+    float u, v;
+    float size;
+    float borderWidth;
+    float aspect[2];
+    float offset[2];
+    float radius[4];
+    float color[4];
+    float shadowColor[4];
+    float borderColor[4];
+};
+
+static const QSGGeometry::AttributeSet &batchedAttributes()
+{
+    static const QSGGeometry::Attribute attributes[] = {
+        QSGGeometry::Attribute::createWithAttributeType(0, 2, QSGGeometry::FloatType, QSGGeometry::PositionAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(1, 4, QSGGeometry::FloatType, QSGGeometry::TexCoordAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(2, 4, QSGGeometry::FloatType, QSGGeometry::UnknownAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(3, 4, QSGGeometry::FloatType, QSGGeometry::UnknownAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(4, 4, QSGGeometry::FloatType, QSGGeometry::ColorAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(5, 4, QSGGeometry::FloatType, QSGGeometry::ColorAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(6, 4, QSGGeometry::FloatType, QSGGeometry::ColorAttribute),
+    };
+    static const QSGGeometry::AttributeSet set = {7, sizeof(BatchedVertex), attributes};
+    return set;
+}
+
+static void writeColor(float *target, const QColor &color)
+{
+    target[0] = color.redF();
+    target[1] = color.greenF();
+    target[2] = color.blueF();
+    target[3] = color.alphaF();
+}
+
+BatchedShadowedRectangleNode::BatchedShadowedRectangleNode()
+{
+    // Replaces, and deletes, the geometry of ShadowedRectangleNode
+    m_geometry = new QSGGeometry{batchedAttributes(), 4};
+    setGeometry(m_geometry);
+}
+
+ShadowedRectangleNode *BatchedShadowedRectangleNode::create()
+{
+    if (qEnvironmentVariableIsSet("KIRIGAMI_NO_BATCHED_RECTANGLES")) {
+        return new ShadowedRectangleNode{};
+    }
+    return new BatchedShadowedRectangleNode{};
+}
+
+void BatchedShadowedRectangleNode::updateGeometry()
+{
+    BatchedVertex vertex;
+    vertex.aspect[0] = m_material->aspect.x();
+    vertex.aspect[1] = m_material->aspect.y();
+    vertex.offset[0] = m_material->offset.x();
+    vertex.offset[1] = m_material->offset.y();
+    vertex.size = m_material->size;
+    vertex.radius[0] = m_material->radius.x();
+    vertex.radius[1] = m_material->radius.y();
+    vertex.radius[2] = m_material->radius.z();
+    vertex.radius[3] = m_material->radius.w();
+    writeColor(vertex.color, m_material->color);
+    writeColor(vertex.shadowColor, m_material->shadowColor);
+
+    if (m_material->type() == borderMaterialType()) {
+        auto borderMaterial = static_cast<ShadowedBorderRectangleMaterial *>(m_material);
+        vertex.borderWidth = borderMaterial->borderWidth;
+        writeColor(vertex.borderColor, borderMaterial->borderColor);
+    } else {
+        vertex.borderWidth = 0.0;
+        writeColor(vertex.borderColor, Qt::transparent);
+    }
+
+    // Where the shader would output nothing but the opaque color
+    QRectF interior;
+    if (qFuzzyCompare(m_material->color.alphaF(), 1.0)) {
+        const qreal minDimension = std::min(rect().width(), rect().height());
+        const QVector4D radius = m_material->radius * minDimension / 2.0;
+        const qreal inset = std::max({radius.x(), radius.y(), radius.z(), radius.w()})
+            + vertex.borderWidth * minDimension
+            + s_interiorMargin;
+        interior = rect().adjusted(inset, inset, -inset, -inset);
+        if (interior.width() < s_minimumInteriorSize || interior.height() < s_minimumInteriorSize) {
+            interior = QRectF{};
+        }
+    }
+    updateInterior(interior);
+
+    const QRectF outer = geometryRect();
+    QVector<QPointF> points;
+    if (interior.isEmpty()) {
+        // In the same order as QSGGeometry::updateTexturedRectGeometry()
+        points = {outer.topLeft(), outer.bottomLeft(), outer.topRight(), outer.bottomRight()};
+    } else {
+        // A strip going around the interior
+        points = {
+            outer.topLeft(), interior.topLeft(),
+            outer.topRight(), interior.topRight(),
+            outer.bottomRight(), interior.bottomRight(),
+            outer.bottomLeft(), interior.bottomLeft(),
+            outer.topLeft(), interior.topLeft()
+        };
+    }
+
+    if (m_geometry->vertexCount() != points.size()) {
+        m_geometry->allocate(points.size());
+    }
+
+    auto vertices = static_cast<BatchedVertex *>(m_geometry->vertexData());
+    for (int i = 0; i < points.size(); ++i) {
+        vertex.x = points.at(i).x();
+        vertex.y = points.at(i).y();
+        vertex.u = (points.at(i).x() - outer.left()) / outer.width();
+        vertex.v = (points.at(i).y() - outer.top()) / outer.height();
+        vertices[i] = vertex;
+    }
+
+    markDirty(QSGNode::DirtyGeometry);
+}
+
+void BatchedShadowedRectangleNode::updateInterior(const QRectF &interior)
+{
+    if (interior.isEmpty()) {
+        if (m_interiorNode) {
+            removeChildNode(m_interiorNode);
+            delete m_interiorNode;
+            m_interiorNode = nullptr;
+            m_interiorMaterial = nullptr;
+        }
+        return;
+    }
+
+    if (!m_interiorNode) {
+        m_interiorNode = new QSGGeometryNode;
+        m_interiorNode->setGeometry(new QSGGeometry{QSGGeometry::defaultAttributes_Point2D(), 4});
+        m_interiorMaterial = new QSGFlatColorMaterial;
+        m_interiorNode->setMaterial(m_interiorMaterial);
+        m_interiorNode->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+        appendChildNode(m_interiorNode);
+    }
+
+    QSGGeometry::updateRectGeometry(m_interiorNode->geometry(), interior);
+    m_interiorNode->markDirty(QSGNode::DirtyGeometry);
+
+    // Opaque, so premultiplied or not doesn't matter
+    if (m_interiorMaterial->color() != m_material->color) {
+        m_interiorMaterial->setColor(m_material->color);
+        m_interiorNode->markDirty(QSGNode::DirtyMaterial);
+    }
+}
+
+ShadowedRectangleMaterial *BatchedShadowedRectangleNode::createBorderlessMaterial()
+{
+    return new BatchedShadowedRectangleMaterial{};
+}
+
+ShadowedBorderRectangleMaterial *BatchedShadowedRectangleNode::createBorderMaterial()
+{
+    return new BatchedShadowedBorderRectangleMaterial{};
+}
+
+QSGMaterialType *BatchedShadowedRectangleNode::borderlessMaterialType()
+{
+    return m_shaderType == ShadowedRectangleMaterial::ShaderType::LowPower ? &BatchedShadowedRectangleMaterial::lowPowerType : &BatchedShadowedRectangleMaterial::staticType;
+}
+
+QSGMaterialType *BatchedShadowedRectangleNode::borderMaterialType()
+{
+    return m_shaderType == ShadowedRectangleMaterial::ShaderType::LowPower ? &BatchedShadowedBorderRectangleMaterial::lowPowerType : &BatchedShadowedBorderRectangleMaterial::staticType;
+}
@@ -0,0 +1,58 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include "shadowedrectanglenode.h"
+
+class QSGFlatColorMaterial;
+
+/**
+ * Scene graph node for a shadowed rectangle that can be batched.
+ *
+ * This node looks exactly like ShadowedRectangleNode, but stores the colors,
+ * radius, shadow and border of the rectangle in its vertices instead of its
+ * material. All these nodes thus share the same material state and the
+ * scene graph renderer merges them into a few draw calls, which makes a
+ * big difference for views full of cards.
+ *
+ * When its color is opaque, the interior of a large rectangle, where the
+ * distance field shader would only output that color, is left out of the
+ * geometry, which becomes a ring around it. A child node fills it with a
+ * flat color instead, which the renderer draws in its opaque pass, so that
+ * the expensive shader only runs over the edges and the shadow.
+ *
+ * \note You must call updateGeometry() after setting properties of this node,
+ * as it is what updates the vertices.
+ */
+class BatchedShadowedRectangleNode : public ShadowedRectangleNode
+{
+public:
+    BatchedShadowedRectangleNode();
+
+    /**
+     * @returns a new BatchedShadowedRectangleNode, or a plain
+     * ShadowedRectangleNode when the KIRIGAMI_NO_BATCHED_RECTANGLES
+     * environment variable is set, to tell rendering issues of the batching
+     * apart. The variable is read for every node, so that tests can compare
+     * both within a process.
+     */
+    static ShadowedRectangleNode *create();
+
+    void updateGeometry() override;
+
+protected:
+    ShadowedRectangleMaterial *createBorderlessMaterial() override;
+    ShadowedBorderRectangleMaterial *createBorderMaterial() override;
+    QSGMaterialType *borderlessMaterialType() override;
+    QSGMaterialType *borderMaterialType() override;
+
+private:
+    void updateInterior(const QRectF &interior);
+
+    QSGGeometryNode *m_interiorNode = nullptr;
+    QSGFlatColorMaterial *m_interiorMaterial = nullptr;
+};
@@ -0,0 +1,168 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "cachedshadownode.h"
+#include "managedimagecache.h"
+#include "managedtexturenode.h"
+#include "shadowrenderer.h"
+
+#include <QQuickWindow>
+#include <QSGTextureMaterial>
+
+#include <algorithm>
+#include <cmath>
+
+// Shadow images up to this size go in the scene graph's texture atlas
+static const int s_atlasSizeLimit = 128;
+
+namespace {
+
+/**
+ * Everything the image of a shadow depends on.
+ */
+struct ShadowKey
+{
+    int rectSize = 0;
+    int margin = 0;
+    QVector4D radius;
+    float size = 0.0f;
+    QRgb color = 0;
+    float devicePixelRatio = 1.0f;
+
+    bool operator==(const ShadowKey &other) const
+    {
+        return rectSize == other.rectSize
+            && margin == other.margin
+            && radius == other.radius
+            && size == other.size
+            && color == other.color
+            && devicePixelRatio == other.devicePixelRatio;
+    }
+};
+
+uint qHash(const ShadowKey &key, uint seed = 0)
+{
+    seed = ::qHash(key.rectSize, seed) ^ ::qHash(key.margin, seed << 1);
+    seed = ::qHash(key.radius.x(), seed) ^ ::qHash(key.radius.y(), seed << 1);
+    seed = ::qHash(key.radius.z(), seed) ^ ::qHash(key.radius.w(), seed << 1);
+    seed = ::qHash(key.size, seed) ^ ::qHash(key.color, seed << 1);
+    return ::qHash(key.devicePixelRatio, seed);
+}
+
+QImage renderShadow(const ShadowKey &key)
+{
+    const int logicalSize = key.rectSize + key.margin * 2;
+    const int pixelSize = std::ceil(logicalSize * key.devicePixelRatio);
+
+    QImage image(pixelSize, pixelSize, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(qreal(pixelSize) / logicalSize);
+    ShadowRenderer::render(image, QRectF(key.margin, key.margin, key.rectSize, key.rectSize), key.radius, key.size, key.color);
+    return image;
+}
+
+}
+
+// The images of shadows, shared by every window, of which the render threads
+// update the nodes. It is created in the GUI thread though, see createCache().
+Q_GLOBAL_STATIC_WITH_ARGS(ManagedImageCache<ShadowKey>, s_shadowImageCache, (QStringLiteral("ShadowImageCache"), 4096))
+Q_GLOBAL_STATIC(ImageTexturesCache, s_shadowTexturesCache)
+
+void CachedShadowNode::createCache()
+{
+    s_shadowImageCache();
+}
+
+CachedShadowNode::CachedShadowNode()
+{
+    m_geometry = new QSGGeometry{QSGGeometry::defaultAttributes_TexturedPoint2D(), 16, 54};
+    m_geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+    setGeometry(m_geometry);
+
+    m_material = new QSGTextureMaterial;
+    m_material->setFiltering(QSGTexture::Linear);
+    setMaterial(m_material);
+
+    setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+
+    writeIndices();
+}
+
+void CachedShadowNode::writeIndices()
+{
+    // Quads over a four by four grid of vertices, the centre one last,
+    // so that it is left out by leaving out the last six indices
+    static const int order[] = {0, 1, 2, 3, 5, 6, 7, 8, 4};
+
+    quint16 *indices = m_geometry->indexDataAsUShort();
+    const int quads = m_geometry->indexCount() / 6;
+    for (int i = 0; i < quads; ++i) {
+        const quint16 topLeft = order[i] / 3 * 4 + order[i] % 3;
+        const quint16 quad[] = {topLeft, quint16(topLeft + 4), quint16(topLeft + 1), quint16(topLeft + 1), quint16(topLeft + 4), quint16(topLeft + 5)};
+        std::copy(std::begin(quad), std::end(quad), indices);
+        indices += 6;
+    }
+}
+
+void CachedShadowNode::update(QQuickWindow *window, const QRectF &rect, const QVector4D &radius, qreal size, const QVector2D &offset, const QColor &color, bool opaqueRectangle)
+{
+    const float minDimension = std::min(rect.width(), rect.height());
+    if (minDimension <= 0.0f) {
+        return;
+    }
+
+    ShadowKey key;
+    key.radius = ShadowRenderer::shadowRadius(radius, size, minDimension);
+    const float maximumRadius = std::max({key.radius.x(), key.radius.y(), key.radius.z(), key.radius.w()});
+
+    key.rectSize = ShadowRenderer::ninePatchSize(maximumRadius + size / 2.0f, minDimension);
+    key.margin = std::ceil(size / 2.0) + 1;
+    key.size = size;
+    key.color = color.rgba();
+    key.devicePixelRatio = window->devicePixelRatio();
+
+    QImage image = s_shadowImageCache->find(key);
+    if (image.isNull()) {
+        image = renderShadow(key);
+        s_shadowImageCache->insert(key, image);
+    }
+    QQuickWindow::CreateTextureOptions options;
+    if (image.width() <= s_atlasSizeLimit) {
+        options |= QQuickWindow::TextureCanUseAtlas;
+    }
+    auto texture = s_shadowTexturesCache->loadTexture(window, image, options);
+    if (texture != m_texture) {
+        m_texture = texture;
+        m_material->setTexture(m_texture.data());
+        markDirty(QSGNode::DirtyMaterial);
+    }
+
+    const int imageSize = key.rectSize + key.margin * 2;
+    const QRectF outer = rect.translated(offset.toPointF()).adjusted(-key.margin, -key.margin, key.margin, key.margin);
+    const auto xs = ShadowRenderer::ninePatchEdges(outer.left(), outer.right(), imageSize);
+    const auto ys = ShadowRenderer::ninePatchEdges(outer.top(), outer.bottom(), imageSize);
+
+    // An opaque rectangle hides the centre of its shadow, unless the offset
+    // moves it out from under the rectangle or its rounded corners
+    const QRectF hidden = rect.adjusted(maximumRadius, maximumRadius, -maximumRadius, -maximumRadius);
+    const bool drawCentre = !opaqueRectangle || !hidden.contains(QRectF(QPointF(xs[1], ys[1]), QPointF(xs[2], ys[2])));
+    const int indexCount = drawCentre ? 54 : 48;
+    if (m_geometry->indexCount() != indexCount) {
+        m_geometry->allocate(16, indexCount);
+        writeIndices();
+    }
+
+    const QRectF source = m_texture->normalizedTextureSubRect();
+    const float us[] = {float(source.left()), float(source.center().x()), float(source.center().x()), float(source.right())};
+    const float vs[] = {float(source.top()), float(source.center().y()), float(source.center().y()), float(source.bottom())};
+
+    auto vertices = m_geometry->vertexDataAsTexturedPoint2D();
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            vertices[row * 4 + column].set(xs[column], ys[row], us[column], vs[row]);
+        }
+    }
+    markDirty(QSGNode::DirtyGeometry);
+}
@@ -0,0 +1,59 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QColor>
+#include <QSGGeometryNode>
+#include <QSharedPointer>
+#include <QVector2D>
+#include <QVector4D>
+
+class QQuickWindow;
+class QSGTexture;
+class QSGTextureMaterial;
+
+/**
+ * Scene graph node drawing the shadow of a rectangle from a texture.
+ *
+ * The shadow is rendered once, on the CPU, with the same distance field as
+ * ShadowedRectangleMaterial, then drawn as a nine-patch: rectangles of
+ * different sizes but with the same corners and shadow share the same image
+ * and texture, and identical cards are merged into a single draw call.
+ *
+ * The rectangle itself is drawn by a child node, without shadow, so that it
+ * ends up above the shadow.
+ *
+ * \sa ShadowedRectangle
+ */
+class CachedShadowNode : public QSGGeometryNode
+{
+public:
+    CachedShadowNode();
+
+    /**
+     * Creates the cache of shadow images shared by all nodes, and registers
+     * it with CacheManager, which is not thread safe. Must be called from
+     * the GUI thread before any node is updated in a render thread.
+     */
+    static void createCache();
+
+    /**
+     * Updates the geometry and texture for the shadow of @p rect.
+     *
+     * Parameters are in logical pixels, as given to ShadowedRectangleNode.
+     * When @p opaqueRectangle is true, the part of the shadow the
+     * rectangle hides isn't drawn.
+     */
+    void update(QQuickWindow *window, const QRectF &rect, const QVector4D &radius, qreal size, const QVector2D &offset, const QColor &color, bool opaqueRectangle = false);
+
+private:
+    void writeIndices();
+
+    QSGGeometry *m_geometry;
+    QSGTextureMaterial *m_material;
+    QSharedPointer<QSGTexture> m_texture;
+};
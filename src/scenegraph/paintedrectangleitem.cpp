@@ -5,13 +5,105 @@
  */
 
 #include "paintedrectangleitem.h"
+#include "managedimagecache.h"
+#include "shadowrenderer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <QPainter>
+#include <QQuickWindow>
+
+namespace {
+
+/**
+ * Everything the nine-patch image of a PaintedRectangleItem depends on.
+ */
+struct PaintedRectangleKey
+{
+    int rectSize = 0;
+    int margin = 0;
+    float radius = 0.0f;
+    float borderWidth = 0.0f;
+    QRgb color = 0;
+    QRgb borderColor = 0;
+    float shadowSize = 0.0f;
+    float shadowRadius = 0.0f;
+    float shadowXOffset = 0.0f;
+    float shadowYOffset = 0.0f;
+    QRgb shadowColor = 0;
+    float devicePixelRatio = 1.0f;
+
+    bool operator==(const PaintedRectangleKey &other) const
+    {
+        return rectSize == other.rectSize
+            && margin == other.margin
+            && radius == other.radius
+            && borderWidth == other.borderWidth
+            && color == other.color
+            && borderColor == other.borderColor
+            && shadowSize == other.shadowSize
+            && shadowRadius == other.shadowRadius
+            && shadowXOffset == other.shadowXOffset
+            && shadowYOffset == other.shadowYOffset
+            && shadowColor == other.shadowColor
+            && devicePixelRatio == other.devicePixelRatio;
+    }
+};
+
+uint qHash(const PaintedRectangleKey &key, uint seed = 0)
+{
+    seed = ::qHash(key.rectSize, seed) ^ ::qHash(key.margin, seed << 1);
+    seed = ::qHash(key.radius, seed) ^ ::qHash(key.borderWidth, seed << 1);
+    seed = ::qHash(key.color, seed) ^ ::qHash(key.borderColor, seed << 1);
+    seed = ::qHash(key.shadowSize, seed) ^ ::qHash(key.shadowRadius, seed << 1);
+    seed = ::qHash(key.shadowXOffset, seed) ^ ::qHash(key.shadowYOffset, seed << 1);
+    seed = ::qHash(key.shadowColor, seed) ^ ::qHash(key.devicePixelRatio, seed << 1);
+    return seed;
+}
+
+QImage renderPaintedRectangle(const PaintedRectangleKey &key)
+{
+    const int logicalSize = key.rectSize + key.margin * 2;
+    const int pixelSize = std::ceil(logicalSize * key.devicePixelRatio);
+
+    QImage image(pixelSize, pixelSize, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(qreal(pixelSize) / logicalSize);
+
+    const QRectF rect(key.margin, key.margin, key.rectSize, key.rectSize);
+    if (key.shadowSize > 0.0f) {
+        const QVector4D radius(key.shadowRadius, key.shadowRadius, key.shadowRadius, key.shadowRadius);
+        ShadowRenderer::render(image, rect.translated(key.shadowXOffset, key.shadowYOffset), radius, key.shadowSize, key.shadowColor);
+    } else {
+        image.fill(Qt::transparent);
+    }
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(Qt::transparent);
+
+    if (key.borderWidth > 0.0f) {
+        painter.setBrush(QColor::fromRgba(key.borderColor));
+        painter.drawRoundedRect(rect, key.radius, key.radius);
+    }
+
+    painter.setBrush(QColor::fromRgba(key.color));
+    painter.drawRoundedRect(rect.adjusted(key.borderWidth, key.borderWidth, -key.borderWidth, -key.borderWidth), key.radius, key.radius);
+
+    return image;
+}
+
+}
+
+// The nine-patch images of PaintedRectangleItem, shared by every window.
+// Painting may happen in the render thread of any window, but the cache is
+// created in the GUI thread, by the items.
+Q_GLOBAL_STATIC_WITH_ARGS(ManagedImageCache<PaintedRectangleKey>, s_paintedRectangleCache, (QStringLiteral("PaintedRectangleCache"), 4096))
 
 PaintedRectangleItem::PaintedRectangleItem(QQuickItem* parent)
     : QQuickPaintedItem(parent)
 {
+    // Registering with CacheManager isn't thread safe, so it can't wait for paint()
+    s_paintedRectangleCache();
 }
 
 void PaintedRectangleItem::setColor(const QColor& color)
@@ -38,19 +130,103 @@ void PaintedRectangleItem::setBorderWidth(qreal width)
     update();
 }
 
+void PaintedRectangleItem::setShadowSize(qreal size)
+{
+    m_shadowSize = size;
+    updateGeometry();
+}
+
+void PaintedRectangleItem::setShadowOffset(const QPointF& offset)
+{
+    m_shadowOffset = offset;
+    updateGeometry();
+}
+
+void PaintedRectangleItem::setShadowColor(const QColor& color)
+{
+    m_shadowColor = color;
+    updateGeometry();
+}
+
+void PaintedRectangleItem::setRectangleSize(const QSizeF& size)
+{
+    m_rectangleSize = size;
+    updateGeometry();
+}
+
 void PaintedRectangleItem::paint(QPainter* painter)
 {
-    painter->setRenderHint(QPainter::Antialiasing, true);
-    painter->setPen(Qt::transparent);
+    const qreal minDimension = std::min(m_rectangleSize.width(), m_rectangleSize.height());
+    if (minDimension <= 0.0 || !window()) {
+        return;
+    }
+
+    PaintedRectangleKey key;
+    key.margin = shadowMargin();
+    key.radius = std::min(m_radius, minDimension / 2);
+    key.borderWidth = std::floor(m_borderWidth);
+    key.color = m_color.rgba();
+    key.borderColor = m_borderColor.rgba();
+    key.devicePixelRatio = window()->devicePixelRatio();
+
+    float cornerSize = std::max(key.radius, key.borderWidth);
+    if (hasShadow()) {
+        key.shadowSize = m_shadowSize;
+        key.shadowXOffset = m_shadowOffset.x();
+        key.shadowYOffset = m_shadowOffset.y();
+        key.shadowColor = m_shadowColor.rgba();
+
+        const float maximumOffset = std::max(std::abs(key.shadowXOffset), std::abs(key.shadowYOffset));
+        key.shadowRadius = ShadowRenderer::shadowRadius(QVector4D(key.radius, key.radius, key.radius, key.radius), key.shadowSize, minDimension).x();
+        cornerSize = std::max(cornerSize, key.shadowRadius + key.shadowSize / 2.0f + maximumOffset);
+    }
+    key.rectSize = ShadowRenderer::ninePatchSize(cornerSize, minDimension);
 
-    auto radius = std::min(m_radius, std::min(width(), height()) / 2);
-    auto borderWidth = std::floor(m_borderWidth);
+    QImage image = s_paintedRectangleCache->find(key);
+    if (image.isNull()) {
+        image = renderPaintedRectangle(key);
+        s_paintedRectangleCache->insert(key, image);
+    }
+
+    // Blit the nine patches: corners as they are, edges and middle stretched
+    const int imageSize = key.rectSize + key.margin * 2;
+    const auto xs = ShadowRenderer::ninePatchEdges(0.0, width(), imageSize);
+    const auto ys = ShadowRenderer::ninePatchEdges(0.0, height(), imageSize);
 
-    if (borderWidth > 0.0) {
-        painter->setBrush(m_borderColor);
-        painter->drawRoundedRect(0, 0, width(), height(), radius, radius);
+    // Any line of the middle of the image will do for the stretched parts
+    const qreal center = image.width() / 2.0;
+    const qreal us[] = {0.0, center - 0.5, center + 0.5, qreal(image.width())};
+    const qreal vs[] = {0.0, center - 0.5, center + 0.5, qreal(image.height())};
+
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            const QRectF target(QPointF(xs[column], ys[row]), QPointF(xs[column + 1], ys[row + 1]));
+            if (target.width() <= 0.0 || target.height() <= 0.0) {
+                continue;
+            }
+            painter->drawImage(target, image, QRectF(QPointF(us[column], vs[row]), QPointF(us[column + 1], vs[row + 1])));
+        }
     }
+}
+
+bool PaintedRectangleItem::hasShadow() const
+{
+    return m_shadowSize > 0.0 && m_shadowColor.alpha() > 0;
+}
 
-    painter->setBrush(m_color);
-    painter->drawRoundedRect(borderWidth, borderWidth, width() - borderWidth * 2, height() - borderWidth * 2, radius, radius);
+int PaintedRectangleItem::shadowMargin() const
+{
+    if (!hasShadow()) {
+        return 0;
+    }
+    return std::ceil(m_shadowSize / 2.0) + std::ceil(std::max(std::abs(m_shadowOffset.x()), std::abs(m_shadowOffset.y()))) + 1;
+}
+
+void PaintedRectangleItem::updateGeometry()
+{
+    // The item covers the shadow, around the rectangle
+    const int margin = shadowMargin();
+    setPosition(QPointF(-margin, -margin));
+    setSize(m_rectangleSize + QSizeF(margin * 2, margin * 2));
+    update();
 }
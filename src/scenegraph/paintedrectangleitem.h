@@ -8,6 +8,7 @@
 #define PAINTEDRECTANGLEITEM_H
 
 #include <QQuickPaintedItem>
+#include <QSizeF>
 
 /**
  * A rectangle with a border and rounded corners, rendered through QPainter.
@@ -16,7 +17,14 @@
  * rendering is used, which means our shaders cannot be used.
  *
  * Since we cannot actually use QSGPaintedNode, we need to do some trickery
- * using QQuickPaintedItem as a child of ShadowedRectangle.
+ * using QQuickPaintedItem as a child of ShadowedRectangle. The item covers
+ * the shadow as well as the rectangle, so it is larger than the rectangle,
+ * which is set with setRectangleSize() rather than with the size of the item.
+ *
+ * Painting curves and blurs with QPainter is slow, so the rectangle and its
+ * shadow are rendered once per style into a small nine-patch image, shared
+ * by every item with the same style, that is then stretched to the size of
+ * the rectangle.
  *
  * \warning This item is **not** intended as a general purpose item.
  */
@@ -30,14 +38,26 @@ public:
     void setRadius(qreal radius);
     void setBorderColor(const QColor &color);
     void setBorderWidth(qreal width);
+    void setShadowSize(qreal size);
+    void setShadowOffset(const QPointF &offset);
+    void setShadowColor(const QColor &color);
+    void setRectangleSize(const QSizeF &size);
 
     void paint(QPainter *painter) override;
 
 private:
+    bool hasShadow() const;
+    int shadowMargin() const;
+    void updateGeometry();
+
     QColor m_color;
     qreal m_radius = 0.0;
     QColor m_borderColor;
     qreal m_borderWidth = 0.0;
+    qreal m_shadowSize = 0.0;
+    QPointF m_shadowOffset;
+    QColor m_shadowColor;
+    QSizeF m_rectangleSize;
 };
 
 #endif // PAINTEDRECTANGLEITEM_H
@@ -0,0 +1,19 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+// This file is included before the fragment shaders of rectangles when they
+// are drawn batched, see shadowedrectangle_batched.vert. The parameters of
+// each rectangle then come from the vertices rather than from uniforms, so
+// that rectangles of different colors, radii and shadows can be merged into
+// a single draw call.
+
+#define BATCHED
+
+#ifdef CORE_PROFILE
+#define PARAMETER in
+#else
+#define PARAMETER varying
+#endif
@@ -10,14 +10,19 @@
 // In addition it renders a border around it.
 
 uniform lowp float opacity;
-uniform lowp float size;
-uniform lowp vec4 radius;
-uniform lowp vec4 color;
-uniform lowp vec4 shadowColor;
-uniform lowp vec2 offset;
-uniform lowp vec2 aspect;
-uniform lowp float borderWidth;
-uniform lowp vec4 borderColor;
+
+// Uniforms, unless batched, see batched.glsl
+#ifndef BATCHED
+#define PARAMETER uniform
+#endif
+PARAMETER lowp float size;
+PARAMETER lowp vec4 radius;
+PARAMETER lowp vec4 color;
+PARAMETER lowp vec4 shadowColor;
+PARAMETER lowp vec2 offset;
+PARAMETER lowp vec2 aspect;
+PARAMETER lowp float borderWidth;
+PARAMETER lowp vec4 borderColor;
 
 #ifdef CORE_PROFILE
 in lowp vec2 uv;
@@ -9,12 +9,17 @@
 // This shader renders a rectangle with rounded corners and a shadow below it.
 
 uniform lowp float opacity;
-uniform lowp float size;
-uniform lowp vec4 radius;
-uniform lowp vec4 color;
-uniform lowp vec4 shadowColor;
-uniform lowp vec2 offset;
-uniform lowp vec2 aspect;
+
+// Uniforms, unless batched, see batched.glsl
+#ifndef BATCHED
+#define PARAMETER uniform
+#endif
+PARAMETER lowp float size;
+PARAMETER lowp vec4 radius;
+PARAMETER lowp vec4 color;
+PARAMETER lowp vec4 shadowColor;
+PARAMETER lowp vec2 offset;
+PARAMETER lowp vec2 aspect;
 
 #ifdef CORE_PROFILE
 in lowp vec2 uv;
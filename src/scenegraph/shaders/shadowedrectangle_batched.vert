@@ -0,0 +1,61 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+// A version of shadowedrectangle.vert that passes the parameters of each
+// rectangle, stored in its vertices, to the fragment shader. They fit in 7
+// attributes, as the batch renderer may add an eighth one.
+
+uniform highp mat4 matrix;
+
+#ifdef CORE_PROFILE
+in highp vec4 in_vertex;
+in mediump vec4 in_uv_size_border_width;
+in mediump vec4 in_aspect_offset;
+in mediump vec4 in_radius;
+in mediump vec4 in_color;
+in mediump vec4 in_shadow_color;
+in mediump vec4 in_border_color;
+out mediump vec2 uv;
+out mediump vec2 aspect;
+out mediump vec2 offset;
+out mediump float size;
+out mediump float borderWidth;
+out mediump vec4 radius;
+out mediump vec4 color;
+out mediump vec4 shadowColor;
+out mediump vec4 borderColor;
+#else
+attribute highp vec4 in_vertex;
+attribute mediump vec4 in_uv_size_border_width;
+attribute mediump vec4 in_aspect_offset;
+attribute mediump vec4 in_radius;
+attribute mediump vec4 in_color;
+attribute mediump vec4 in_shadow_color;
+attribute mediump vec4 in_border_color;
+varying mediump vec2 uv;
+varying mediump vec2 aspect;
+varying mediump vec2 offset;
+varying mediump float size;
+varying mediump float borderWidth;
+varying mediump vec4 radius;
+varying mediump vec4 color;
+varying mediump vec4 shadowColor;
+varying mediump vec4 borderColor;
+#endif
+
+void main() {
+    aspect = in_aspect_offset.xy;
+    offset = in_aspect_offset.zw;
+    size = in_uv_size_border_width.z;
+    borderWidth = in_uv_size_border_width.w;
+    radius = in_radius;
+    color = in_color;
+    shadowColor = in_shadow_color;
+    borderColor = in_border_color;
+
+    uv = (-1.0 + 2.0 * in_uv_size_border_width.xy) * aspect;
+    gl_Position = matrix * in_vertex;
+}
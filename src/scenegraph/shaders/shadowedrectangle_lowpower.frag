@@ -10,12 +10,17 @@
 // (PinePhone). It does not render a shadow and does not do alpha blending.
 
 uniform lowp float opacity;
-uniform lowp float size;
-uniform lowp vec4 radius;
-uniform lowp vec4 color;
-uniform lowp vec4 shadowColor;
-uniform lowp vec2 offset;
-uniform lowp vec2 aspect;
+
+// Uniforms, unless batched, see batched.glsl
+#ifndef BATCHED
+#define PARAMETER uniform
+#endif
+PARAMETER lowp float size;
+PARAMETER lowp vec4 radius;
+PARAMETER lowp vec4 color;
+PARAMETER lowp vec4 shadowColor;
+PARAMETER lowp vec2 offset;
+PARAMETER lowp vec2 aspect;
 
 #ifdef CORE_PROFILE
 in lowp vec2 uv;
@@ -0,0 +1,28 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+// This shader renders the alpha channel of a texture in a single color.
+// It is the GPU version of painting the color over an image with
+// QPainter::CompositionMode_SourceIn.
+
+uniform lowp float opacity;
+uniform lowp vec4 color;
+uniform sampler2D textureSource;
+
+#ifdef CORE_PROFILE
+in mediump vec2 uv;
+out lowp vec4 out_color;
+#else
+varying mediump vec2 uv;
+#define out_color gl_FragColor
+#define texture texture2D
+#endif
+
+void main()
+{
+    // color is premultiplied
+    out_color = color * texture(textureSource, uv).a * opacity;
+}
@@ -0,0 +1,57 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "shaderwarmupitem.h"
+#include "batchedshadowedrectanglenode.h"
+#include "shadowedtexturenode.h"
+#include "tintedtexturenode.h"
+
+ShaderWarmUpItem::ShaderWarmUpItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    // Out of the window, so that nothing shows up
+    setPosition(QPointF(-10.0, -10.0));
+    setSize(QSizeF(1.0, 1.0));
+    setFlag(QQuickItem::ItemHasContents, true);
+}
+
+bool ShaderWarmUpItem::isPainted() const
+{
+    return m_painted;
+}
+
+QSGNode *ShaderWarmUpItem::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+
+    if (node) {
+        return node;
+    }
+
+    node = new QSGNode{};
+    const QRectF rect = boundingRect();
+
+    for (auto shaderType : {ShadowedRectangleMaterial::ShaderType::Standard, ShadowedRectangleMaterial::ShaderType::LowPower}) {
+        for (bool border : {false, true}) {
+            ShadowedRectangleNode *children[] = {new BatchedShadowedRectangleNode{}, new ShadowedTextureNode{}};
+            for (auto child : children) {
+                child->setShaderType(shaderType);
+                child->setBorderEnabled(border);
+                child->setRect(rect);
+                child->setBorderWidth(border ? 1.0 : 0.0);
+                child->updateGeometry();
+                node->appendChildNode(child);
+            }
+        }
+    }
+
+    auto tintedNode = new TintedTextureNode{};
+    tintedNode->setRect(rect);
+    node->appendChildNode(tintedNode);
+
+    m_painted = true;
+    return node;
+}
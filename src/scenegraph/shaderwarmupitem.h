@@ -0,0 +1,45 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QQuickItem>
+
+#include <atomic>
+
+/**
+ * An item drawing, once and outside of the window, a node with every
+ * material of Kirigami: standard and low power, with and without border,
+ * of ShadowedRectangle, ShadowedTexture and Icon.
+ *
+ * The scene graph compiles the shaders of materials the first time it draws
+ * them, which otherwise happens when the first card or sheet shows up. As
+ * Qt keeps the binaries of the programs it links, both in memory and in its
+ * shader disk cache, later uses and later runs of the application skip
+ * compilation.
+ *
+ * This is a helper used by ShaderQuality, which deletes it once drawn.
+ *
+ * \warning This item is **not** intended as a general purpose item.
+ */
+class ShaderWarmUpItem : public QQuickItem
+{
+    Q_OBJECT
+public:
+    explicit ShaderWarmUpItem(QQuickItem *parent = nullptr);
+
+    /**
+     * Whether the nodes were handed to the scene graph. Safe to call from any
+     * thread.
+     */
+    bool isPainted() const;
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData *data) override;
+
+private:
+    std::atomic<bool> m_painted{false};
+};
@@ -9,6 +9,7 @@
 #include <QOpenGLContext>
 
 QSGMaterialType ShadowedBorderRectangleMaterial::staticType;
+QSGMaterialType ShadowedBorderRectangleMaterial::lowPowerType;
 
 ShadowedBorderRectangleMaterial::ShadowedBorderRectangleMaterial()
 {
@@ -22,7 +23,7 @@ QSGMaterialShader* ShadowedBorderRectangleMaterial::createShader() const
 
 QSGMaterialType* ShadowedBorderRectangleMaterial::type() const
 {
-    return &staticType;
+    return shaderType == ShaderType::LowPower ? &lowPowerType : &staticType;
 }
 
 int ShadowedBorderRectangleMaterial::compare(const QSGMaterial *other) const
@@ -27,6 +27,7 @@ public:
     QColor borderColor = Qt::black;
 
     static QSGMaterialType staticType;
+    static QSGMaterialType lowPowerType;
 };
 
 class ShadowedBorderRectangleShader : public ShadowedRectangleShader
@@ -9,6 +9,7 @@
 #include <QOpenGLContext>
 
 QSGMaterialType ShadowedBorderTextureMaterial::staticType;
+QSGMaterialType ShadowedBorderTextureMaterial::lowPowerType;
 
 ShadowedBorderTextureMaterial::ShadowedBorderTextureMaterial()
     : ShadowedBorderRectangleMaterial()
@@ -23,7 +24,7 @@ QSGMaterialShader* ShadowedBorderTextureMaterial::createShader() const
 
 QSGMaterialType* ShadowedBorderTextureMaterial::type() const
 {
-    return &staticType;
+    return shaderType == ShaderType::LowPower ? &lowPowerType : &staticType;
 }
 
 int ShadowedBorderTextureMaterial::compare(const QSGMaterial *other) const
@@ -22,6 +22,7 @@ public:
     QSGTexture *textureSource = nullptr;
 
     static QSGMaterialType staticType;
+    static QSGMaterialType lowPowerType;
 };
 
 class ShadowedBorderTextureShader : public ShadowedBorderRectangleShader
@@ -9,6 +9,7 @@
 #include <QOpenGLContext>
 
 QSGMaterialType ShadowedRectangleMaterial::staticType;
+QSGMaterialType ShadowedRectangleMaterial::lowPowerType;
 
 ShadowedRectangleMaterial::ShadowedRectangleMaterial()
 {
@@ -22,7 +23,7 @@ QSGMaterialShader* ShadowedRectangleMaterial::createShader() const
 
 QSGMaterialType* ShadowedRectangleMaterial::type() const
 {
-    return &staticType;
+    return shaderType == ShaderType::LowPower ? &lowPowerType : &staticType;
 }
 
 int ShadowedRectangleMaterial::compare(const QSGMaterial *other) const
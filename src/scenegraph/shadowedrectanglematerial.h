@@ -38,7 +38,10 @@ public:
     QVector2D offset;
     ShaderType shaderType = ShaderType::Standard;
 
+    // The scene graph creates one shader per material type, so the low power
+    // variant needs a type of its own
     static QSGMaterialType staticType;
+    static QSGMaterialType lowPowerType;
 };
 
 class ShadowedRectangleShader : public QSGMaterialShader
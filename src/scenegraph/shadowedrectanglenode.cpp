@@ -171,6 +171,17 @@ void ShadowedRectangleNode::setShaderType(ShadowedRectangleMaterial::ShaderType
 }
 
 void ShadowedRectangleNode::updateGeometry()
+{
+    QSGGeometry::updateTexturedRectGeometry(m_geometry, geometryRect(), QRectF{0.0, 0.0, 1.0, 1.0});
+    markDirty(QSGNode::DirtyGeometry);
+}
+
+QRectF ShadowedRectangleNode::rect() const
+{
+    return m_rect;
+}
+
+QRectF ShadowedRectangleNode::geometryRect() const
 {
     auto rect = m_rect;
     if (m_shaderType == ShadowedRectangleMaterial::ShaderType::Standard) {
@@ -183,8 +194,7 @@ void ShadowedRectangleNode::updateGeometry()
                             offsetLength * m_aspect.x(), offsetLength * m_aspect.y());
     }
 
-    QSGGeometry::updateTexturedRectGeometry(m_geometry, rect, QRectF{0.0, 0.0, 1.0, 1.0});
-    markDirty(QSGNode::DirtyGeometry);
+    return rect;
 }
 
 ShadowedRectangleMaterial *ShadowedRectangleNode::createBorderlessMaterial()
@@ -199,10 +209,10 @@ ShadowedBorderRectangleMaterial *ShadowedRectangleNode::createBorderMaterial()
 
 QSGMaterialType *ShadowedRectangleNode::borderlessMaterialType()
 {
-    return &ShadowedRectangleMaterial::staticType;
+    return m_shaderType == ShadowedRectangleMaterial::ShaderType::LowPower ? &ShadowedRectangleMaterial::lowPowerType : &ShadowedRectangleMaterial::staticType;
 }
 
 QSGMaterialType *ShadowedRectangleNode::borderMaterialType()
 {
-    return &ShadowedBorderRectangleMaterial::staticType;
+    return m_shaderType == ShadowedRectangleMaterial::ShaderType::LowPower ? &ShadowedBorderRectangleMaterial::lowPowerType : &ShadowedBorderRectangleMaterial::staticType;
 }
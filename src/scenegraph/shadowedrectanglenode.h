@@ -56,9 +56,15 @@ public:
      * This is done as an explicit step to avoid the geometry being recreated
      * multiple times while updating properties.
      */
-    void updateGeometry();
+    virtual void updateGeometry();
 
 protected:
+    /**
+     * The rectangle covered by the geometry, including the shadow.
+     */
+    QRectF geometryRect() const;
+    QRectF rect() const;
+
     virtual ShadowedRectangleMaterial *createBorderlessMaterial();
     virtual ShadowedBorderRectangleMaterial *createBorderMaterial();
     virtual QSGMaterialType* borderMaterialType();
@@ -9,6 +9,7 @@
 #include <QOpenGLContext>
 
 QSGMaterialType ShadowedTextureMaterial::staticType;
+QSGMaterialType ShadowedTextureMaterial::lowPowerType;
 
 ShadowedTextureMaterial::ShadowedTextureMaterial()
     : ShadowedRectangleMaterial()
@@ -23,7 +24,7 @@ QSGMaterialShader* ShadowedTextureMaterial::createShader() const
 
 QSGMaterialType* ShadowedTextureMaterial::type() const
 {
-    return &staticType;
+    return shaderType == ShaderType::LowPower ? &lowPowerType : &staticType;
 }
 
 int ShadowedTextureMaterial::compare(const QSGMaterial *other) const
@@ -28,6 +28,7 @@ public:
     QSGTexture *textureSource = nullptr;
 
     static QSGMaterialType staticType;
+    static QSGMaterialType lowPowerType;
 };
 
 class ShadowedTextureShader : public ShadowedRectangleShader
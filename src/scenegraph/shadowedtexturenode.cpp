@@ -47,9 +47,25 @@ void ShadowedTextureNode::setTextureSource(QSGTextureProvider *source)
     markDirty(QSGNode::DirtyMaterial);
 }
 
+void ShadowedTextureNode::setTexture(const QSharedPointer<QSGTexture> &texture)
+{
+    if (m_texture == texture) {
+        return;
+    }
+
+    m_texture = texture;
+    markDirty(QSGNode::DirtyMaterial);
+}
+
 void ShadowedTextureNode::preprocess()
 {
-    if (m_textureSource && m_material && m_textureSource->texture()) {
+    if (m_texture && m_material) {
+        if (m_material->type() == borderlessMaterialType()) {
+            static_cast<ShadowedTextureMaterial*>(m_material)->textureSource = m_texture.data();
+        } else {
+            static_cast<ShadowedBorderTextureMaterial*>(m_material)->textureSource = m_texture.data();
+        }
+    } else if (m_textureSource && m_material && m_textureSource->texture()) {
         if (m_material->type() == borderlessMaterialType()) {
             preprocessTexture<ShadowedTextureMaterial>(m_material, m_textureSource);
         } else {
@@ -70,10 +86,10 @@ ShadowedBorderRectangleMaterial *ShadowedTextureNode::createBorderMaterial()
 
 QSGMaterialType *ShadowedTextureNode::borderlessMaterialType()
 {
-    return &ShadowedTextureMaterial::staticType;
+    return m_shaderType == ShadowedRectangleMaterial::ShaderType::LowPower ? &ShadowedTextureMaterial::lowPowerType : &ShadowedTextureMaterial::staticType;
 }
 
 QSGMaterialType *ShadowedTextureNode::borderMaterialType()
 {
-    return &ShadowedBorderTextureMaterial::staticType;
+    return m_shaderType == ShadowedRectangleMaterial::ShaderType::LowPower ? &ShadowedBorderTextureMaterial::lowPowerType : &ShadowedBorderTextureMaterial::staticType;
 }
@@ -8,6 +8,7 @@
 
 #include <QPointer>
 #include <QSGTextureProvider>
+#include <QSharedPointer>
 
 #include "shadowedrectanglenode.h"
 #include "shadowedtexturematerial.h"
@@ -30,6 +31,11 @@ public:
     ShadowedTextureNode();
 
     void setTextureSource(QSGTextureProvider *source);
+    /**
+     * Uses @p texture, which must not be in an atlas, instead of a texture source.
+     * The node keeps it alive, so that it can be shared with ImageTexturesCache.
+     */
+    void setTexture(const QSharedPointer<QSGTexture> &texture);
     void preprocess() override;
 
 private:
@@ -39,4 +45,5 @@ private:
     QSGMaterialType *borderMaterialType() override;
 
     QPointer<QSGTextureProvider> m_textureSource;
+    QSharedPointer<QSGTexture> m_texture;
 };
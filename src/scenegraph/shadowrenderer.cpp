@@ -0,0 +1,71 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "shadowrenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Should match minimum_shadow_radius in shadowedrectangle.frag
+static const float s_minimumShadowRadius = 0.05f;
+
+static float roundedRectangle(float x, float y, float halfWidth, float halfHeight, const QVector4D &radius)
+{
+    // Same as sdf_rounded_rectangle() in sdf.glsl
+    const float r = x > 0.0f ? (y > 0.0f ? radius.x() : radius.y()) : (y > 0.0f ? radius.z() : radius.w());
+    const float dx = std::abs(x) - halfWidth + r;
+    const float dy = std::abs(y) - halfHeight + r;
+    const float outsideX = std::max(dx, 0.0f);
+    const float outsideY = std::max(dy, 0.0f);
+    const float outside = std::sqrt(outsideX * outsideX + outsideY * outsideY);
+    return std::min(std::max(dx, dy), 0.0f) + outside - r;
+}
+
+static float smoothstep(float edge0, float edge1, float x)
+{
+    const float t = std::min(std::max((x - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+QVector4D ShadowRenderer::shadowRadius(const QVector4D &radius, float size, float minDimension)
+{
+    QVector4D result;
+    for (int i = 0; i < 4; ++i) {
+        const float cornerRadius = std::min(radius[i], minDimension / 2.0f);
+        const float normalizedRadius = cornerRadius * 2.0f / minDimension;
+        result[i] = cornerRadius + size * 0.5f * (s_minimumShadowRadius / std::max(normalizedRadius, s_minimumShadowRadius));
+    }
+    return result;
+}
+
+void ShadowRenderer::render(QImage &image, const QRectF &rect, const QVector4D &radius, float size, QRgb color)
+{
+    const float scale = 1.0f / image.devicePixelRatio();
+    const float centerX = rect.center().x();
+    const float centerY = rect.center().y();
+    const float halfWidth = rect.width() / 2.0f;
+    const float halfHeight = rect.height() / 2.0f;
+
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const float distance = roundedRectangle((x + 0.5f) * scale - centerX, (y + 0.5f) * scale - centerY, halfWidth, halfHeight, radius);
+            const float alpha = (1.0f - smoothstep(-size * 0.5f, size * 0.5f, distance)) * qAlpha(color) / 255.0f;
+            line[x] = qPremultiply(qRgba(qRed(color), qGreen(color), qBlue(color), qRound(alpha * 255.0f)));
+        }
+    }
+}
+
+int ShadowRenderer::ninePatchSize(float cornerSize, float minDimension)
+{
+    return std::max(1, std::min(int(minDimension), int(std::ceil(cornerSize + 1.0f)) * 2 + 2));
+}
+
+std::array<float, 4> ShadowRenderer::ninePatchEdges(qreal start, qreal end, int imageSize)
+{
+    const qreal half = imageSize / 2.0;
+    return {float(start), float(start + half), float(end - half), float(end)};
+}
@@ -0,0 +1,53 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QImage>
+
+#include <array>
+#include <QRectF>
+#include <QVector4D>
+
+/**
+ * The shadow of shadowedrectangle.frag, rendered on the CPU.
+ *
+ * Used where shadows are rendered once and then reused: the textures of
+ * CachedShadowNode and the images of PaintedRectangleItem. Both draw them
+ * as nine-patches, laid out by the helpers below.
+ */
+namespace ShadowRenderer
+{
+/**
+ * @returns the corner radii of the shadow of a rectangle with corner radii
+ * @p radius, in pixels: like the shader, larger shadows get rounder corners.
+ */
+QVector4D shadowRadius(const QVector4D &radius, float size, float minDimension);
+
+/**
+ * Fills @p image, which must be in ARGB32_Premultiplied, with the shadow of
+ * a rectangle with corner radii @p radius (as returned by shadowRadius()).
+ *
+ * @p rect is in logical pixels, the device pixel ratio of @p image being
+ * taken into account.
+ */
+void render(QImage &image, const QRectF &rect, const QVector4D &radius, float size, QRgb color);
+
+/**
+ * @returns the side of the square rectangle rendered in a nine-patch image,
+ * whose corners span @p cornerSize: just large enough for them not to
+ * overlap, the middle of it being stretched to the size of the actual
+ * rectangle, of which @p minDimension is the smallest side.
+ */
+int ninePatchSize(float cornerSize, float minDimension);
+
+/**
+ * @returns the edges, along one axis, of the patches of a nine-patch image
+ * of logical size @p imageSize stretched from @p start to @p end: each half
+ * of the image goes to a corner, and its middle line is stretched between.
+ */
+std::array<float, 4> ninePatchEdges(qreal start, qreal end, int imageSize);
+}
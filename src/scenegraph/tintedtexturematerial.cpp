@@ -0,0 +1,107 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "tintedtexturematerial.h"
+
+#include <QOpenGLContext>
+
+QSGMaterialType TintedTextureMaterial::staticType;
+
+TintedTextureMaterial::TintedTextureMaterial()
+{
+    setFlag(QSGMaterial::Blending, true);
+}
+
+QSGMaterialShader* TintedTextureMaterial::createShader() const
+{
+    return new TintedTextureShader{};
+}
+
+QSGMaterialType* TintedTextureMaterial::type() const
+{
+    return &staticType;
+}
+
+int TintedTextureMaterial::compare(const QSGMaterial *other) const
+{
+    auto material = static_cast<const TintedTextureMaterial *>(other);
+
+    // Textures in the same atlas share their id, so those icons can be batched
+    const int textureId = textureSource ? textureSource->textureId() : 0;
+    const int otherTextureId = material->textureSource ? material->textureSource->textureId() : 0;
+    if (textureId != otherTextureId) {
+        return textureId < otherTextureId ? -1 : 1;
+    }
+
+    if (filtering != material->filtering) {
+        return filtering < material->filtering ? -1 : 1;
+    }
+
+    const QRgb rgba = color.rgba();
+    const QRgb otherRgba = material->color.rgba();
+    if (rgba != otherRgba) {
+        return rgba < otherRgba ? -1 : 1;
+    }
+
+    return 0;
+}
+
+TintedTextureShader::TintedTextureShader()
+{
+    auto header = QOpenGLContext::currentContext()->isOpenGLES() ? QStringLiteral("header_es.glsl") : QStringLiteral("header_desktop.glsl");
+
+    auto shaderRoot = QStringLiteral(":/org/kde/kirigami/shaders/");
+
+    setShaderSourceFiles(QOpenGLShader::Vertex, {
+        shaderRoot + header,
+        shaderRoot + QStringLiteral("tintedtexture.vert")
+    });
+
+    setShaderSourceFiles(QOpenGLShader::Fragment, {
+        shaderRoot + header,
+        shaderRoot + QStringLiteral("tintedtexture.frag")
+    });
+}
+
+const char *const * TintedTextureShader::attributeNames() const
+{
+    static char const *const names[] = {"in_vertex", "in_uv", nullptr};
+    return names;
+}
+
+void TintedTextureShader::initialize()
+{
+    QSGMaterialShader::initialize();
+    m_matrixLocation = program()->uniformLocation("matrix");
+    m_opacityLocation = program()->uniformLocation("opacity");
+    m_colorLocation = program()->uniformLocation("color");
+    program()->setUniformValue("textureSource", 0);
+}
+
+void TintedTextureShader::updateState(const QSGMaterialShader::RenderState& state, QSGMaterial* newMaterial, QSGMaterial* oldMaterial)
+{
+    auto p = program();
+
+    if (state.isMatrixDirty()) {
+        p->setUniformValue(m_matrixLocation, state.combinedMatrix());
+    }
+
+    if (state.isOpacityDirty()) {
+        p->setUniformValue(m_opacityLocation, state.opacity());
+    }
+
+    auto material = static_cast<TintedTextureMaterial *>(newMaterial);
+    if (!oldMaterial || newMaterial->compare(oldMaterial) != 0 || state.isCachedMaterialDataDirty()) {
+        // Premultiplied, like everything in the scene graph
+        const QColor color = material->color;
+        p->setUniformValue(m_colorLocation, QVector4D(color.redF() * color.alphaF(), color.greenF() * color.alphaF(), color.blueF() * color.alphaF(), color.alphaF()));
+    }
+
+    if (material->textureSource) {
+        material->textureSource->setFiltering(material->filtering);
+        material->textureSource->bind();
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QColor>
+#include <QSGMaterial>
+#include <QSGMaterialShader>
+#include <QSGTexture>
+
+/**
+ * A material rendering the alpha channel of a texture in a single color.
+ *
+ * This is used to tint monochrome icons on the GPU, so that changing their
+ * color only changes a uniform and one texture can be used for every color.
+ */
+class TintedTextureMaterial : public QSGMaterial
+{
+public:
+    TintedTextureMaterial();
+
+    QSGMaterialShader* createShader() const override;
+    QSGMaterialType* type() const override;
+    int compare(const QSGMaterial* other) const override;
+
+    QSGTexture *textureSource = nullptr;
+    QSGTexture::Filtering filtering = QSGTexture::Nearest;
+    QColor color = Qt::black;
+
+    static QSGMaterialType staticType;
+};
+
+class TintedTextureShader : public QSGMaterialShader
+{
+public:
+    TintedTextureShader();
+
+    char const *const *attributeNames() const override;
+
+    void initialize() override;
+    void updateState(const QSGMaterialShader::RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial) override;
+
+private:
+    int m_matrixLocation = -1;
+    int m_opacityLocation = -1;
+    int m_colorLocation = -1;
+};
@@ -0,0 +1,68 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "tintedtexturenode.h"
+
+TintedTextureNode::TintedTextureNode()
+{
+    m_geometry = new QSGGeometry{QSGGeometry::defaultAttributes_TexturedPoint2D(), 4};
+    setGeometry(m_geometry);
+    setFlag(QSGNode::OwnsGeometry, true);
+
+    m_material = new TintedTextureMaterial{};
+    setMaterial(m_material);
+    setFlag(QSGNode::OwnsMaterial, true);
+}
+
+void TintedTextureNode::setTexture(QSharedPointer<QSGTexture> texture)
+{
+    if (texture == m_texture) {
+        return;
+    }
+
+    m_texture = texture;
+    m_material->textureSource = texture.data();
+    markDirty(QSGNode::DirtyMaterial);
+    // An atlas texture is a different part of the atlas
+    updateGeometry();
+}
+
+void TintedTextureNode::setRect(const QRectF &rect)
+{
+    if (rect == m_rect) {
+        return;
+    }
+
+    m_rect = rect;
+    updateGeometry();
+}
+
+void TintedTextureNode::setColor(const QColor &color)
+{
+    if (color == m_material->color) {
+        return;
+    }
+
+    m_material->color = color;
+    markDirty(QSGNode::DirtyMaterial);
+}
+
+void TintedTextureNode::setFiltering(QSGTexture::Filtering filtering)
+{
+    if (filtering == m_material->filtering) {
+        return;
+    }
+
+    m_material->filtering = filtering;
+    markDirty(QSGNode::DirtyMaterial);
+}
+
+void TintedTextureNode::updateGeometry()
+{
+    const QRectF sourceRect = m_texture ? m_texture->normalizedTextureSubRect() : QRectF(0, 0, 1, 1);
+    QSGGeometry::updateTexturedRectGeometry(m_geometry, m_rect, sourceRect);
+    markDirty(QSGNode::DirtyGeometry);
+}
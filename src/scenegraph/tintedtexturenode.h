@@ -0,0 +1,39 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QSGGeometryNode>
+#include <QSharedPointer>
+
+#include "tintedtexturematerial.h"
+
+/**
+ * Scene graph node drawing a texture tinted with a single color.
+ *
+ * Like ManagedTextureNode, it keeps a reference to a texture shared
+ * through ImageTexturesCache.
+ *
+ * \sa TintedTextureMaterial
+ */
+class TintedTextureNode : public QSGGeometryNode
+{
+public:
+    TintedTextureNode();
+
+    void setTexture(QSharedPointer<QSGTexture> texture);
+    void setRect(const QRectF &rect);
+    void setColor(const QColor &color);
+    void setFiltering(QSGTexture::Filtering filtering);
+
+private:
+    void updateGeometry();
+
+    QSGGeometry *m_geometry;
+    TintedTextureMaterial *m_material;
+    QSharedPointer<QSGTexture> m_texture;
+    QRectF m_rect;
+};
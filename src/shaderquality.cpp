@@ -0,0 +1,363 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "shaderquality.h"
+#include "scenegraph/shaderwarmupitem.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QQuickWindow>
+#include <QSGRendererInterface>
+#include <QScreen>
+
+// Renderers that are too slow for the standard shaders from the start:
+// software rasterizers and the weakest GPUs of embedded boards
+static const char *s_lowPowerRenderers[] = {
+    "llvmpipe",
+    "softpipe",
+    "swrast",
+    "SwiftShader",
+    "Software Rasterizer",
+    "Mali-400",
+    "Mali-450",
+    "VideoCore IV",
+    "PowerVR SGX",
+    "Vivante GC",
+};
+
+// Weight of the last frame in the average time between frames
+static const double s_smoothing = 0.1;
+// Frames rendered before a decision, after startup or a switch
+static const int s_minimumSamples = 60;
+// Frames rendered in time before going back to the standard shaders
+static const int s_upgradeSamples = 600;
+// Average time between frames, in frame intervals of the screen, above which
+// too many frames miss the vsync
+static const double s_downgradeRatio = 1.5;
+// Average time between frames, in frame intervals of the screen, under which
+// rendering keeps up with the vsync
+static const double s_upgradeRatio = 1.1;
+// Switches to the low power shaders after which they are kept for good
+static const int s_maximumDowngrades = 3;
+// Time between frames, in frame intervals of the screen, above which the
+// window was idle rather than slow
+static const int s_idleRatio = 4;
+
+ShaderQuality::ShaderQuality(QQuickWindow *window, QObject *parent)
+    : QObject(parent)
+    , m_window(window)
+    , m_minimumSamples(s_minimumSamples)
+    , m_upgradeSamples(s_upgradeSamples)
+    , m_downgradeRatio(s_downgradeRatio)
+    , m_upgradeRatio(s_upgradeRatio)
+    , m_maximumDowngrades(s_maximumDowngrades)
+{
+    const QByteArray lowPower = qgetenv("KIRIGAMI_LOWPOWER_HARDWARE").toLower();
+    if (lowPower == "1" || lowPower == "true") {
+        m_mode = LowPower;
+    } else if (lowPower == "0" || lowPower == "false") {
+        m_mode = Standard;
+    }
+    m_automatic = m_mode == Automatic;
+
+    if (!window) {
+        return;
+    }
+
+    updateFrameBudget();
+    connect(window, &QWindow::screenChanged, this, &ShaderQuality::updateFrameBudget);
+
+    // Rendering happens in the render thread, if any, hence direct connections
+    connect(window, &QQuickWindow::beforeRendering, this, &ShaderQuality::frameStarted, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this, &ShaderQuality::frameSwapped, Qt::DirectConnection);
+    connect(window, &QQuickWindow::sceneGraphInvalidated, this, [this]() {
+        // The next context may not use the same renderer
+        m_probed = false;
+        m_swapTimer.invalidate();
+    }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::sceneGraphInitialized, this, [this]() {
+        if (m_warmUp) {
+            startWarmUp();
+        }
+    }, Qt::QueuedConnection);
+}
+
+ShaderQuality::~ShaderQuality()
+{
+}
+
+ShaderQuality *ShaderQuality::forWindow(QQuickWindow *window)
+{
+    return qobject_cast<ShaderQuality *>(qmlAttachedPropertiesObject<ShaderQuality>(window, true));
+}
+
+ShaderQuality::Mode ShaderQuality::mode() const
+{
+    return m_mode;
+}
+
+void ShaderQuality::setMode(Mode mode)
+{
+    if (mode == m_mode) {
+        return;
+    }
+
+    const bool wasLowPower = isLowPower();
+    m_mode = mode;
+    m_automatic = mode == Automatic;
+    Q_EMIT modeChanged();
+
+    if (isLowPower() != wasLowPower) {
+        Q_EMIT lowPowerChanged();
+    }
+}
+
+bool ShaderQuality::isLowPower() const
+{
+    switch (m_mode) {
+    case Standard:
+        return false;
+    case LowPower:
+        return true;
+    default:
+        return m_detectedLowPower;
+    }
+}
+
+QString ShaderQuality::renderer() const
+{
+    return m_renderer;
+}
+
+bool ShaderQuality::warmUp() const
+{
+    return m_warmUp;
+}
+
+void ShaderQuality::setWarmUp(bool warmUp)
+{
+    if (warmUp == m_warmUp) {
+        return;
+    }
+
+    m_warmUp = warmUp;
+    Q_EMIT warmUpChanged();
+
+    if (m_warmUp && m_window && m_window->isSceneGraphInitialized()) {
+        startWarmUp();
+    }
+}
+
+int ShaderQuality::minimumSamples() const
+{
+    return m_minimumSamples;
+}
+
+void ShaderQuality::setMinimumSamples(int minimumSamples)
+{
+    if (minimumSamples == m_minimumSamples) {
+        return;
+    }
+
+    m_minimumSamples = minimumSamples;
+    Q_EMIT minimumSamplesChanged();
+}
+
+int ShaderQuality::upgradeSamples() const
+{
+    return m_upgradeSamples;
+}
+
+void ShaderQuality::setUpgradeSamples(int upgradeSamples)
+{
+    if (upgradeSamples == m_upgradeSamples) {
+        return;
+    }
+
+    m_upgradeSamples = upgradeSamples;
+    Q_EMIT upgradeSamplesChanged();
+}
+
+double ShaderQuality::downgradeRatio() const
+{
+    return m_downgradeRatio;
+}
+
+void ShaderQuality::setDowngradeRatio(double downgradeRatio)
+{
+    if (downgradeRatio == m_downgradeRatio) {
+        return;
+    }
+
+    m_downgradeRatio = downgradeRatio;
+    Q_EMIT downgradeRatioChanged();
+}
+
+double ShaderQuality::upgradeRatio() const
+{
+    return m_upgradeRatio;
+}
+
+void ShaderQuality::setUpgradeRatio(double upgradeRatio)
+{
+    if (upgradeRatio == m_upgradeRatio) {
+        return;
+    }
+
+    m_upgradeRatio = upgradeRatio;
+    Q_EMIT upgradeRatioChanged();
+}
+
+int ShaderQuality::maximumDowngrades() const
+{
+    return m_maximumDowngrades;
+}
+
+void ShaderQuality::setMaximumDowngrades(int maximumDowngrades)
+{
+    if (maximumDowngrades == m_maximumDowngrades) {
+        return;
+    }
+
+    m_maximumDowngrades = maximumDowngrades;
+    Q_EMIT maximumDowngradesChanged();
+}
+
+ShaderQuality *ShaderQuality::qmlAttachedProperties(QObject *object)
+{
+    auto window = qobject_cast<QQuickWindow *>(object);
+    if (!window) {
+        qWarning() << "ShaderQuality can only be attached to windows, not to" << object;
+    }
+    return new ShaderQuality(window, object);
+}
+
+void ShaderQuality::frameStarted()
+{
+    if (!m_probed) {
+        probeRenderer();
+    }
+}
+
+void ShaderQuality::frameSwapped()
+{
+    // Swapping waits for the GPU and for the vsync, so frames come one frame
+    // interval of the screen apart when rendering keeps up, and a multiple of
+    // it when they miss the vsync. Timing the rendering itself would only
+    // tell how long the CPU spent issuing the commands.
+    const qint64 interval = m_swapTimer.isValid() ? m_swapTimer.nsecsElapsed() / 1000 : 0;
+    m_swapTimer.start();
+
+    // Frames rendered with forced shaders say nothing about the other ones
+    const int budget = m_frameBudget;
+    if (!m_automatic || budget <= 0 || interval <= 0 || interval > qint64(budget) * s_idleRatio) {
+        return;
+    }
+
+    m_averageFrameInterval = m_samples == 0 ? interval : m_averageFrameInterval * (1.0 - s_smoothing) + interval * s_smoothing;
+    ++m_samples;
+
+    bool lowPower = m_renderLowPower;
+    if (!m_renderLowPower) {
+        lowPower = m_samples >= m_minimumSamples && m_averageFrameInterval > budget * m_downgradeRatio;
+    } else if (!m_lowPowerRenderer && m_downgrades < m_maximumDowngrades) {
+        lowPower = m_samples < m_upgradeSamples || m_averageFrameInterval > budget * m_upgradeRatio;
+    }
+
+    if (lowPower == m_renderLowPower) {
+        return;
+    }
+
+    m_renderLowPower = lowPower;
+    m_samples = 0;
+    if (lowPower) {
+        ++m_downgrades;
+    }
+    QMetaObject::invokeMethod(this, [this, lowPower]() {
+        setDetectedLowPower(lowPower);
+    }, Qt::QueuedConnection);
+}
+
+void ShaderQuality::probeRenderer()
+{
+    m_probed = true;
+
+    auto context = QOpenGLContext::currentContext();
+    if (!context) {
+        return;
+    }
+
+    auto name = reinterpret_cast<const char *>(context->functions()->glGetString(GL_RENDERER));
+    if (!name) {
+        return;
+    }
+
+    const QString renderer = QString::fromLatin1(name);
+    QMetaObject::invokeMethod(this, [this, renderer]() {
+        setRenderer(renderer);
+    }, Qt::QueuedConnection);
+
+    for (auto lowPowerRenderer : s_lowPowerRenderers) {
+        if (renderer.contains(QLatin1String(lowPowerRenderer), Qt::CaseInsensitive)) {
+            m_renderLowPower = true;
+            m_lowPowerRenderer = true;
+            QMetaObject::invokeMethod(this, [this]() {
+                setDetectedLowPower(true);
+            }, Qt::QueuedConnection);
+            break;
+        }
+    }
+}
+
+void ShaderQuality::setDetectedLowPower(bool lowPower)
+{
+    if (lowPower == m_detectedLowPower) {
+        return;
+    }
+
+    const bool wasLowPower = isLowPower();
+    m_detectedLowPower = lowPower;
+    if (isLowPower() != wasLowPower) {
+        Q_EMIT lowPowerChanged();
+    }
+}
+
+void ShaderQuality::setRenderer(const QString &renderer)
+{
+    if (renderer == m_renderer) {
+        return;
+    }
+
+    m_renderer = renderer;
+    Q_EMIT rendererChanged();
+}
+
+void ShaderQuality::updateFrameBudget()
+{
+    const qreal refreshRate = m_window && m_window->screen() ? m_window->screen()->refreshRate() : 0.0;
+    m_frameBudget = qRound(1000000.0 / (refreshRate > 0.0 ? refreshRate : 60.0));
+}
+
+void ShaderQuality::startWarmUp()
+{
+    if (!m_window || m_warmUpItem) {
+        return;
+    }
+
+    // Only the OpenGL renderer uses our shaders
+    auto rendererInterface = m_window->rendererInterface();
+    if (!rendererInterface || rendererInterface->graphicsApi() != QSGRendererInterface::OpenGL) {
+        return;
+    }
+
+    auto item = new ShaderWarmUpItem(m_window->contentItem());
+    m_warmUpItem = item;
+    connect(m_window, &QQuickWindow::frameSwapped, item, [item]() {
+        if (item->isPainted()) {
+            item->deleteLater();
+        }
+    }, Qt::QueuedConnection);
+}
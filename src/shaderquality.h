@@ -0,0 +1,210 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QtQml>
+
+#include <atomic>
+
+class QQuickItem;
+class QQuickWindow;
+
+/**
+ * Chooses, per window, between the standard shaders of ShadowedRectangle and
+ * ShadowedTexture and their cheaper low power variants.
+ *
+ * By default the choice is automatic: windows start with the standard
+ * shaders, unless the OpenGL renderer is known to be a software rasterizer
+ * or a weak GPU, and switch to the low power shaders when frames regularly
+ * miss the vsync, that is when the time between two swapped frames is
+ * regularly longer than the frame interval of the screen. To avoid
+ * flickering between the two, switching back requires frames to keep up with
+ * the vsync for a long while, and after a few switches the low power shaders
+ * are kept for good. The thresholds of these decisions are properties too.
+ *
+ * It is used as an attached property of windows, which can also force
+ * either variant:
+ *
+ * @code{.qml}
+ * Kirigami.ApplicationWindow {
+ *     Kirigami.ShaderQuality.mode: Kirigami.ShaderQuality.LowPower
+ *     title: Kirigami.ShaderQuality.lowPower ? "Low power" : "Standard"
+ * }
+ * @endcode
+ *
+ * The KIRIGAMI_LOWPOWER_HARDWARE environment variable sets the default
+ * mode: `1` or `true` for LowPower, `0` or `false` for Standard.
+ *
+ * @since 5.78
+ * @since org.kde.kirigami 2.15
+ */
+class ShaderQuality : public QObject
+{
+    Q_OBJECT
+
+    /**
+     * How the shaders are chosen, see Mode. Defaults to Automatic.
+     */
+    Q_PROPERTY(Mode mode READ mode WRITE setMode NOTIFY modeChanged)
+
+    /**
+     * Whether the window uses the low power shaders, be it because of mode
+     * or because the automatic detection decided so.
+     */
+    Q_PROPERTY(bool lowPower READ isLowPower NOTIFY lowPowerChanged)
+
+    /**
+     * The OpenGL renderer of the window, once it has been rendered, as
+     * used by the automatic detection.
+     */
+    Q_PROPERTY(QString renderer READ renderer NOTIFY rendererChanged)
+
+    /**
+     * Whether the shaders of Kirigami, in all their variants, are compiled
+     * right after the scene graph of the window is initialized, instead of
+     * when first used, which makes the first card or sheet that opens stutter.
+     * The compiled programs go to the shader disk cache of Qt, unless it is
+     * disabled with Qt::AA_DisableShaderDiskCache, so later runs of the
+     * application load them instead of compiling them again.
+     *
+     * Defaults to false, Kirigami's application windows enable it.
+     */
+    Q_PROPERTY(bool warmUp READ warmUp WRITE setWarmUp NOTIFY warmUpChanged)
+
+    /**
+     * Frames rendered with the standard shaders, after startup or a switch,
+     * before the automatic detection may switch to the low power ones.
+     * Defaults to 60.
+     */
+    Q_PROPERTY(int minimumSamples READ minimumSamples WRITE setMinimumSamples NOTIFY minimumSamplesChanged)
+
+    /**
+     * Frames rendered in time with the low power shaders before the automatic
+     * detection switches back to the standard ones. Defaults to 600.
+     */
+    Q_PROPERTY(int upgradeSamples READ upgradeSamples WRITE setUpgradeSamples NOTIFY upgradeSamplesChanged)
+
+    /**
+     * Average time between two frames, in frame intervals of the screen,
+     * above which the automatic detection switches to the low power shaders.
+     * Defaults to 1.5, that is when every other frame misses the vsync.
+     */
+    Q_PROPERTY(double downgradeRatio READ downgradeRatio WRITE setDowngradeRatio NOTIFY downgradeRatioChanged)
+
+    /**
+     * Average time between two frames, in frame intervals of the screen,
+     * under which frames rendered with the low power shaders count as in
+     * time. Defaults to 1.1.
+     */
+    Q_PROPERTY(double upgradeRatio READ upgradeRatio WRITE setUpgradeRatio NOTIFY upgradeRatioChanged)
+
+    /**
+     * Switches to the low power shaders after which the automatic detection
+     * keeps them for good. Defaults to 3.
+     */
+    Q_PROPERTY(int maximumDowngrades READ maximumDowngrades WRITE setMaximumDowngrades NOTIFY maximumDowngradesChanged)
+
+public:
+    enum Mode {
+        Automatic = 0, /// Detected from the renderer and the time between frames
+        Standard, /// Always the standard shaders
+        LowPower /// Always the low power shaders
+    };
+    Q_ENUM(Mode)
+
+    ~ShaderQuality() override;
+
+    /**
+     * @returns the ShaderQuality of @p window, created if needed.
+     * Must be called from the GUI thread.
+     */
+    static ShaderQuality *forWindow(QQuickWindow *window);
+
+    Mode mode() const;
+    void setMode(Mode mode);
+
+    bool isLowPower() const;
+
+    QString renderer() const;
+
+    bool warmUp() const;
+    void setWarmUp(bool warmUp);
+
+    int minimumSamples() const;
+    void setMinimumSamples(int minimumSamples);
+
+    int upgradeSamples() const;
+    void setUpgradeSamples(int upgradeSamples);
+
+    double downgradeRatio() const;
+    void setDowngradeRatio(double downgradeRatio);
+
+    double upgradeRatio() const;
+    void setUpgradeRatio(double upgradeRatio);
+
+    int maximumDowngrades() const;
+    void setMaximumDowngrades(int maximumDowngrades);
+
+    // QML attached property
+    static ShaderQuality *qmlAttachedProperties(QObject *object);
+
+Q_SIGNALS:
+    void modeChanged();
+    void lowPowerChanged();
+    void rendererChanged();
+    void warmUpChanged();
+    void minimumSamplesChanged();
+    void upgradeSamplesChanged();
+    void downgradeRatioChanged();
+    void upgradeRatioChanged();
+    void maximumDowngradesChanged();
+
+private:
+    explicit ShaderQuality(QQuickWindow *window, QObject *parent);
+
+    // In the render thread
+    void frameStarted();
+    void frameSwapped();
+    void probeRenderer();
+
+    // In the GUI thread
+    void setDetectedLowPower(bool lowPower);
+    void setRenderer(const QString &renderer);
+    void updateFrameBudget();
+    void startWarmUp();
+
+    QPointer<QQuickWindow> m_window;
+    QPointer<QQuickItem> m_warmUpItem;
+    bool m_warmUp = false;
+    Mode m_mode = Automatic;
+    bool m_detectedLowPower = false;
+    QString m_renderer;
+
+    // Written in the GUI thread and read in the render thread
+    std::atomic<bool> m_automatic{true};
+    // In microseconds
+    std::atomic<int> m_frameBudget{0};
+    std::atomic<int> m_minimumSamples;
+    std::atomic<int> m_upgradeSamples;
+    std::atomic<double> m_downgradeRatio;
+    std::atomic<double> m_upgradeRatio;
+    std::atomic<int> m_maximumDowngrades;
+
+    // Only used in the render thread
+    QElapsedTimer m_swapTimer;
+    bool m_probed = false;
+    bool m_renderLowPower = false;
+    bool m_lowPowerRenderer = false;
+    double m_averageFrameInterval = 0.0;
+    int m_samples = 0;
+    int m_downgrades = 0;
+};
+
+QML_DECLARE_TYPEINFO(ShaderQuality, QML_HAS_ATTACHED_PROPERTIES)
@@ -0,0 +1,561 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "shadowedimage.h"
+
+#include <QDebug>
+#include <QGuiApplication>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QQmlEngine>
+#include <QQmlFile>
+#include <QQuickImageProvider>
+#include <QQuickWindow>
+
+#include "cachemanager.h"
+#include "managedimagecache.h"
+#include "scenegraph/batchedshadowedrectanglenode.h"
+#include "scenegraph/managedtexturenode.h"
+#include "scenegraph/shadowedtexturenode.h"
+
+namespace {
+
+/**
+ * The decoded images of ShadowedImage, shared by every item.
+ *
+ * Unlike icons, images may be large photos. Images shown by an item are
+ * shared whatever their size, only the ones no item shows anymore are kept
+ * up to a budget, as the pixmap cache of Qt Quick does. Only used in the
+ * GUI thread.
+ */
+class ShadowedImageCache
+{
+public:
+    ShadowedImageCache()
+        // In kilobytes, for the images no item shows
+        : m_unusedImages(QStringLiteral("ShadowedImageCache"), 20480)
+    {
+    }
+
+    QImage find(const IconCacheKey &key)
+    {
+        auto it = m_usedImages.constFind(key);
+        if (it != m_usedImages.constEnd()) {
+            return it->image;
+        }
+        return m_unusedImages.find(key);
+    }
+
+    /**
+     * Marks the image of @p key as shown by one more item.
+     */
+    void acquire(const IconCacheKey &key, const QImage &image)
+    {
+        UsedImage &used = m_usedImages[key];
+        if (used.count == 0) {
+            used.image = image;
+            m_unusedImages.remove(key);
+        }
+        ++used.count;
+    }
+
+    /**
+     * Marks the image of @p key as shown by one item less.
+     */
+    void release(const IconCacheKey &key)
+    {
+        auto it = m_usedImages.find(key);
+        if (it == m_usedImages.end() || --it->count > 0) {
+            return;
+        }
+
+        const QImage image = it->image;
+        m_usedImages.erase(it);
+        // Images larger than the budget are dropped right away
+        m_unusedImages.insert(key, image);
+        CacheManager::instance()->cacheChanged(&m_unusedImages);
+    }
+
+private:
+    struct UsedImage
+    {
+        QImage image;
+        int count = 0;
+    };
+
+    QHash<IconCacheKey, UsedImage> m_usedImages;
+    // Only the images no item shows can be dropped
+    ManagedImageCache<IconCacheKey> m_unusedImages;
+};
+
+}
+
+Q_GLOBAL_STATIC(ShadowedImageCache, s_shadowedImageCache)
+Q_GLOBAL_STATIC(ImageTexturesCache, s_shadowedImageTexturesCache)
+
+ShadowedImage::ShadowedImage(QQuickItem *parentItem)
+    : ShadowedRectangle(parentItem)
+{
+}
+
+ShadowedImage::~ShadowedImage()
+{
+    if (m_holdsImage) {
+        s_shadowedImageCache->release(m_heldKey);
+    }
+    if (m_networkReply) {
+        m_networkReply->disconnect(this);
+        m_networkReply->abort();
+        m_networkReply->deleteLater();
+    }
+}
+
+QUrl ShadowedImage::source() const
+{
+    return m_source;
+}
+
+void ShadowedImage::setSource(const QUrl &source)
+{
+    if (source == m_source) {
+        return;
+    }
+
+    m_source = source;
+    load();
+    Q_EMIT sourceChanged();
+}
+
+QSize ShadowedImage::sourceSize() const
+{
+    // Like Image, dimensions that aren't set are the ones of the image
+    const QSize imageSize = m_image.isNull() ? QSize(0, 0) : (QSizeF(m_image.size()) / m_image.devicePixelRatio()).toSize();
+    return QSize(m_sourceSize.width() >= 0 ? m_sourceSize.width() : imageSize.width(),
+                 m_sourceSize.height() >= 0 ? m_sourceSize.height() : imageSize.height());
+}
+
+void ShadowedImage::setSourceSize(const QSize &sourceSize)
+{
+    if (sourceSize == m_sourceSize) {
+        return;
+    }
+
+    const QSize oldSourceSize = this->sourceSize();
+    m_sourceSize = sourceSize;
+    load();
+    if (this->sourceSize() != oldSourceSize) {
+        Q_EMIT sourceSizeChanged();
+    }
+}
+
+void ShadowedImage::resetSourceSize()
+{
+    setSourceSize(QSize());
+}
+
+bool ShadowedImage::asynchronous() const
+{
+    return m_asynchronous;
+}
+
+void ShadowedImage::setAsynchronous(bool asynchronous)
+{
+    if (asynchronous == m_asynchronous) {
+        return;
+    }
+
+    m_asynchronous = asynchronous;
+    Q_EMIT asynchronousChanged();
+}
+
+ShadowedImage::FillMode ShadowedImage::fillMode() const
+{
+    return m_fillMode;
+}
+
+void ShadowedImage::setFillMode(FillMode fillMode)
+{
+    if (fillMode == m_fillMode) {
+        return;
+    }
+
+    m_fillMode = fillMode;
+    if (isSoftwareRendering()) {
+        update();
+    }
+    Q_EMIT fillModeChanged();
+}
+
+ShadowedImage::Status ShadowedImage::status() const
+{
+    return m_status;
+}
+
+void ShadowedImage::componentComplete()
+{
+    ShadowedRectangle::componentComplete();
+
+    // The image is drawn above the painted rectangle used in software rendering
+    setFlag(QQuickItem::ItemHasContents, true);
+    load();
+}
+
+void ShadowedImage::itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value)
+{
+    ShadowedRectangle::itemChange(change, value);
+
+    if ((change == QQuickItem::ItemSceneChange && value.window) || change == QQuickItem::ItemDevicePixelRatioHasChanged) {
+        setFlag(QQuickItem::ItemHasContents, true);
+        // The image depends on the device pixel ratio of the window
+        load();
+    }
+}
+
+void ShadowedImage::load()
+{
+    if (!isComponentComplete()) {
+        return;
+    }
+
+    if (m_source.isEmpty()) {
+        IconCache::instance()->cancelRequest(m_key, this);
+        m_key = IconCacheKey();
+        setImage(QImage(), Null);
+        return;
+    }
+
+    IconCacheKey key;
+    key.source = m_source.toString();
+    key.size = m_sourceSize;
+    // Images decoded at their own size don't depend on the device pixel ratio
+    if (m_sourceSize.width() > 0 || m_sourceSize.height() > 0) {
+        key.devicePixelRatio = window() ? window()->devicePixelRatio() : qGuiApp->devicePixelRatio();
+    }
+    key.plainImage = true;
+    if (key == m_key && m_status != Error) {
+        return;
+    }
+    IconCache::instance()->cancelRequest(m_key, this);
+    m_key = key;
+
+    if (m_networkReply) {
+        // Its finished signal checks it is still the current reply
+        auto reply = m_networkReply;
+        m_networkReply.clear();
+        reply->abort();
+    }
+
+    // Identical images are only decoded once, be it by other items
+    const QImage cached = s_shadowedImageCache->find(key);
+    if (!cached.isNull()) {
+        setImage(cached, Ready);
+        return;
+    }
+
+    setImage(QImage(), Loading);
+
+    if (m_source.scheme() == QLatin1String("image")) {
+        loadFromProvider();
+        return;
+    }
+
+    const QString path = QQmlFile::urlToLocalFileOrQrc(m_source);
+    if (path.isEmpty()) {
+        download();
+        return;
+    }
+
+    IconRequest request;
+    request.key = key;
+    request.source = path;
+    request.tintMonochrome = false;
+    // Sizes are in device independent pixels, whatever Qt::AA_UseHighDpiPixmaps says
+    request.highDpiPixmaps = true;
+    if (m_asynchronous) {
+        requestImage(request);
+        return;
+    }
+
+    const IconImage image = IconCache::instance()->loadImage(request);
+    if (image.image.isNull()) {
+        qWarning() << "Could not load image" << m_source;
+        setImage(QImage(), Error);
+    } else {
+        setImage(image.image, Ready);
+    }
+}
+
+void ShadowedImage::loadFromProvider()
+{
+    QQmlEngine *engine = qmlEngine(this);
+    auto provider = engine ? dynamic_cast<QQuickImageProvider *>(engine->imageProvider(m_source.host())) : nullptr;
+    if (!provider) {
+        qWarning() << "No image provider for" << m_source;
+        setImage(QImage(), Error);
+        return;
+    }
+
+    const QString id = m_source.toString(QUrl::RemoveScheme | QUrl::RemoveAuthority).mid(1);
+    // Providers work in pixels, and see unset dimensions as 0
+    const QSize size = m_key.size * m_key.devicePixelRatio;
+    const QSize requestedSize(qMax(0, size.width()), qMax(0, size.height()));
+
+    QSize imageSize;
+    QImage image;
+    switch (provider->imageType()) {
+    case QQmlImageProviderBase::Image:
+        image = provider->requestImage(id, &imageSize, requestedSize);
+        break;
+    case QQmlImageProviderBase::Pixmap:
+        image = provider->requestPixmap(id, &imageSize, requestedSize).toImage();
+        break;
+    case QQmlImageProviderBase::Texture: {
+        QQuickTextureFactory *textureFactory = provider->requestTexture(id, &imageSize, requestedSize);
+        if (textureFactory) {
+            image = textureFactory->image();
+            delete textureFactory;
+        }
+        break;
+    }
+    case QQmlImageProviderBase::ImageResponse: {
+        auto asyncProvider = dynamic_cast<QQuickAsyncImageProvider *>(provider);
+        if (!asyncProvider) {
+            break;
+        }
+        auto response = asyncProvider->requestImageResponse(id, requestedSize);
+        const IconCacheKey key = m_key;
+        connect(response, &QQuickImageResponse::finished, this, [this, response, key]() {
+            response->deleteLater();
+            // The source or the size changed in the meantime
+            if (!(key == m_key) || m_status != Loading) {
+                return;
+            }
+
+            QImage image;
+            if (response->errorString().isEmpty()) {
+                QQuickTextureFactory *textureFactory = response->textureFactory();
+                if (textureFactory) {
+                    image = textureFactory->image();
+                    delete textureFactory;
+                }
+            }
+            setProviderImage(image);
+        });
+        return;
+    }
+    default:
+        break;
+    }
+
+    setProviderImage(image);
+}
+
+void ShadowedImage::download()
+{
+    QQmlEngine *engine = qmlEngine(this);
+    QNetworkAccessManager *networkAccessManager = engine ? engine->networkAccessManager() : nullptr;
+    if (!networkAccessManager) {
+        setImage(QImage(), Error);
+        return;
+    }
+
+    QNetworkRequest request(m_source);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    m_networkReply = networkAccessManager->get(request);
+
+    auto reply = m_networkReply.data();
+    const IconCacheKey key = m_key;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key]() {
+        reply->deleteLater();
+        if (reply != m_networkReply) {
+            return;
+        }
+        m_networkReply.clear();
+
+        if (reply->error() != QNetworkReply::NoError) {
+            qWarning() << "Could not download image" << m_source << reply->errorString();
+            setImage(QImage(), Error);
+            return;
+        }
+
+        // Only the encoded data is kept, IconCache decodes it in a worker
+        // thread, right at the size it is needed
+        IconRequest request;
+        request.key = key;
+        request.source = key.source;
+        request.data = reply->readAll();
+        request.tintMonochrome = false;
+        request.highDpiPixmaps = true;
+        requestImage(request);
+    });
+}
+
+void ShadowedImage::requestImage(const IconRequest &request)
+{
+    // IconCache doesn't keep plain images, they are only handed over here
+    const IconCacheKey key = request.key;
+    IconCache::instance()->requestImage(request, this, [this, key](const IconImage &image) {
+        if (m_status != Loading || !(key == m_key)) {
+            return;
+        }
+        if (image.image.isNull()) {
+            qWarning() << "Could not decode image" << m_source;
+            setImage(QImage(), Error);
+        } else {
+            setImage(image.image, Ready);
+        }
+    });
+}
+
+void ShadowedImage::setProviderImage(const QImage &image)
+{
+    if (image.isNull()) {
+        qWarning() << "Could not load image" << m_source;
+        setImage(QImage(), Error);
+        return;
+    }
+
+    // Like Image, images of providers are shared by url
+    QImage providerImage = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    providerImage.setDevicePixelRatio(m_key.devicePixelRatio);
+    setImage(providerImage, Ready);
+}
+
+void ShadowedImage::setImage(const QImage &image, Status status)
+{
+    const QSize oldSourceSize = sourceSize();
+    const bool changed = image.cacheKey() != m_image.cacheKey();
+
+    // Released first, as it may be acquired again under the same key
+    if (m_holdsImage) {
+        s_shadowedImageCache->release(m_heldKey);
+        m_holdsImage = false;
+    }
+    m_image = image;
+    if (status == Ready && !image.isNull()) {
+        s_shadowedImageCache->acquire(m_key, image);
+        m_heldKey = m_key;
+        m_holdsImage = true;
+    }
+
+    setStatus(status);
+    if (sourceSize() != oldSourceSize) {
+        Q_EMIT sourceSizeChanged();
+    }
+    if (changed) {
+        update();
+    }
+}
+
+void ShadowedImage::setStatus(Status status)
+{
+    if (status == m_status) {
+        return;
+    }
+
+    m_status = status;
+    Q_EMIT statusChanged();
+}
+
+QSGNode *ShadowedImage::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+
+    if (isSoftwareRendering()) {
+        return updateSoftwareNode(node);
+    }
+
+    QSharedPointer<QSGTexture> texture;
+    if (!m_image.isNull()) {
+        // Not in the atlas, as the shaders compute texture coordinates themselves
+        texture = s_shadowedImageTexturesCache->loadTexture(window(), m_image);
+        if (texture) {
+            texture->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+        }
+    }
+
+    auto shadowNode = static_cast<ShadowedRectangleNode*>(node);
+
+    const bool lowPower = isLowPower();
+    const bool textureNode = !texture.isNull();
+    if (!shadowNode || textureNode != m_textureNode || lowPower != m_lowPowerNode) {
+        m_textureNode = textureNode;
+        m_lowPowerNode = lowPower;
+        delete shadowNode;
+        if (textureNode) {
+            shadowNode = new ShadowedTextureNode{};
+        } else {
+            shadowNode = BatchedShadowedRectangleNode::create();
+        }
+
+        if (lowPower) {
+            shadowNode->setShaderType(ShadowedRectangleMaterial::ShaderType::LowPower);
+        }
+    }
+
+    shadowNode->setBorderEnabled(border()->isEnabled());
+    shadowNode->setRect(boundingRect());
+    shadowNode->setSize(shadow()->size());
+    shadowNode->setRadius(corners()->toVector4D(radius()));
+    shadowNode->setOffset(QVector2D{float(shadow()->xOffset()), float(shadow()->yOffset())});
+    shadowNode->setColor(color());
+    shadowNode->setShadowColor(shadow()->color());
+    shadowNode->setBorderWidth(border()->width());
+    shadowNode->setBorderColor(border()->color());
+
+    if (textureNode) {
+        static_cast<ShadowedTextureNode*>(shadowNode)->setTexture(texture);
+    }
+
+    shadowNode->updateGeometry();
+    return shadowNode;
+}
+
+QSGNode *ShadowedImage::updateSoftwareNode(QSGNode *node)
+{
+    // The rectangle and its shadow are painted by the software item below
+    const QRectF rect = boundingRect();
+    if (m_image.isNull() || rect.isEmpty()) {
+        delete node;
+        return nullptr;
+    }
+
+    const QSizeF imageSize = QSizeF(m_image.size()) / m_image.devicePixelRatio();
+    QRectF targetRect = rect;
+    QRectF sourceRect(QPointF(0.0, 0.0), QSizeF(m_image.size()));
+
+    switch (m_fillMode) {
+    case PreserveAspectFit:
+        targetRect.setSize(imageSize.scaled(rect.size(), Qt::KeepAspectRatio));
+        targetRect.moveCenter(rect.center());
+        break;
+    case PreserveAspectCrop:
+        sourceRect.setSize(rect.size().scaled(sourceRect.size(), Qt::KeepAspectRatio));
+        sourceRect.moveCenter(QRectF(QPointF(0.0, 0.0), QSizeF(m_image.size())).center());
+        break;
+    case Pad: {
+        QRectF imageRect(QPointF(0.0, 0.0), imageSize);
+        imageRect.moveCenter(rect.center());
+        targetRect = imageRect & rect;
+        sourceRect = QRectF((targetRect.topLeft() - imageRect.topLeft()) * m_image.devicePixelRatio(),
+                            targetRect.size() * m_image.devicePixelRatio());
+        break;
+    }
+    default:
+        break;
+    }
+
+    auto textureNode = static_cast<ManagedTextureNode*>(node);
+    if (!textureNode) {
+        textureNode = new ManagedTextureNode;
+    }
+    textureNode->setTexture(s_shadowedImageTexturesCache->loadTexture(window(), m_image));
+    textureNode->setRect(targetRect);
+    textureNode->setSourceRect(sourceRect);
+    textureNode->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+    return textureNode;
+}
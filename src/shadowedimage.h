@@ -0,0 +1,163 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QImage>
+#include <QPointer>
+#include <QUrl>
+
+#include "iconcache.h"
+#include "shadowedrectangle.h"
+
+class QNetworkReply;
+
+/**
+ * A rectangle with a shadow, showing an image.
+ *
+ * This is a ShadowedRectangle whose rectangle is filled with the image of
+ * source instead of color, which only shows through transparent parts of
+ * the image and while it loads.
+ *
+ * Images are decoded right at sourceSize, when set, and in worker threads
+ * if asynchronous is true. Items showing the same source at the same size
+ * share the decoded image and its texture. Images no item shows anymore
+ * are kept for a while, in a cache managed by CacheManager.
+ *
+ * @code{.qml}
+ * Kirigami.ShadowedImage {
+ *     width: 300
+ *     height: 200
+ *     radius: Kirigami.Units.smallSpacing
+ *     shadow.size: Kirigami.Units.largeSpacing
+ *     source: "cover.jpg"
+ *     sourceSize.width: width
+ *     asynchronous: true
+ * }
+ * @endcode
+ *
+ * @since 5.69 / 2.12
+ */
+class ShadowedImage : public ShadowedRectangle
+{
+    Q_OBJECT
+
+    /**
+     * The url of the image: a local file, a resource, a remote file or an
+     * image provider url, as for Image.
+     */
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+
+    /**
+     * The size, in device independent pixels, the image is decoded at. The
+     * image is scaled down to fit in it, keeping its aspect ratio, and a
+     * dimension left unset follows this aspect ratio. Raster images are not
+     * scaled up.
+     *
+     * As for Image, dimensions that aren't set read as the size of the
+     * loaded image.
+     */
+    Q_PROPERTY(QSize sourceSize READ sourceSize WRITE setSourceSize RESET resetSourceSize NOTIFY sourceSizeChanged)
+
+    /**
+     * Whether local files are decoded in a worker thread, not to block the
+     * user interface. Remote files are always downloaded and decoded
+     * asynchronously. The default is false.
+     */
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+
+    /**
+     * How the image fills the rectangle, see Image::fillMode.
+     *
+     * The shaders always stretch the image over the rectangle, so this only
+     * applies with software rendering, where tiling is not supported either.
+     * The default is Stretch.
+     */
+    Q_PROPERTY(FillMode fillMode READ fillMode WRITE setFillMode NOTIFY fillModeChanged)
+
+    /**
+     * The status of the image, see Image::status.
+     */
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+
+public:
+    // Same values as Image
+    enum FillMode {
+        Stretch,
+        PreserveAspectFit,
+        PreserveAspectCrop,
+        Tile,
+        TileVertically,
+        TileHorizontally,
+        Pad
+    };
+    Q_ENUM(FillMode)
+
+    enum Status {
+        Null,
+        Ready,
+        Loading,
+        Error
+    };
+    Q_ENUM(Status)
+
+    ShadowedImage(QQuickItem *parent = nullptr);
+    ~ShadowedImage() override;
+
+    QUrl source() const;
+    void setSource(const QUrl &source);
+    Q_SIGNAL void sourceChanged();
+
+    QSize sourceSize() const;
+    void setSourceSize(const QSize &sourceSize);
+    void resetSourceSize();
+    Q_SIGNAL void sourceSizeChanged();
+
+    bool asynchronous() const;
+    void setAsynchronous(bool asynchronous);
+    Q_SIGNAL void asynchronousChanged();
+
+    FillMode fillMode() const;
+    void setFillMode(FillMode fillMode);
+    Q_SIGNAL void fillModeChanged();
+
+    Status status() const;
+    Q_SIGNAL void statusChanged();
+
+    void componentComplete() override;
+
+protected:
+    void itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value) override;
+    QSGNode *updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData *data) override;
+
+private:
+    void load();
+    void loadFromProvider();
+    void download();
+    void requestImage(const IconRequest &request);
+    void setProviderImage(const QImage &image);
+    void setImage(const QImage &image, Status status);
+    void setStatus(Status status);
+    QSGNode *updateSoftwareNode(QSGNode *node);
+
+    QUrl m_source;
+    QSize m_sourceSize;
+    bool m_asynchronous = false;
+    FillMode m_fillMode = Stretch;
+    Status m_status = Null;
+
+    IconCacheKey m_key;
+    QImage m_image;
+    // The key under which m_image is shared with other items, if any
+    IconCacheKey m_heldKey;
+    bool m_holdsImage = false;
+    QPointer<QNetworkReply> m_networkReply;
+
+    // Whether the paint node is a ShadowedTextureNode
+    bool m_textureNode = false;
+    // Whether the paint node uses the low power shaders
+    bool m_lowPowerNode = false;
+};
@@ -10,7 +10,9 @@
 #include <QSGRendererInterface>
 #include <QSGRectangleNode>
 
-#include "scenegraph/shadowedrectanglenode.h"
+#include "shaderquality.h"
+#include "scenegraph/batchedshadowedrectanglenode.h"
+#include "scenegraph/cachedshadownode.h"
 #include "scenegraph/paintedrectangleitem.h"
 
 BorderGroup::BorderGroup(QObject* parent)
@@ -113,6 +115,21 @@ void ShadowGroup::setColor(const QColor & newColor)
     Q_EMIT changed();
 }
 
+bool ShadowGroup::isCached() const
+{
+    return m_cached;
+}
+
+void ShadowGroup::setCached(bool newCached)
+{
+    if (newCached == m_cached) {
+        return;
+    }
+
+    m_cached = newCached;
+    Q_EMIT changed();
+}
+
 CornersGroup::CornersGroup(QObject* parent)
     : QObject(parent)
 {
@@ -196,6 +213,9 @@ ShadowedRectangle::ShadowedRectangle(QQuickItem *parentItem)
 {
     setFlag(QQuickItem::ItemHasContents, true);
 
+    // Shadows may be cached as soon as the first frame, in the render thread
+    CachedShadowNode::createCache();
+
     connect(m_border.get(), &BorderGroup::changed, this, &ShadowedRectangle::update);
     connect(m_shadow.get(), &ShadowGroup::changed, this, &ShadowedRectangle::update);
     connect(m_corners.get(), &CornersGroup::changed, this, &ShadowedRectangle::update);
@@ -268,6 +288,11 @@ bool ShadowedRectangle::isSoftwareRendering() const
     return window() && window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software;
 }
 
+bool ShadowedRectangle::isLowPower() const
+{
+    return m_shaderQuality && m_shaderQuality->isLowPower();
+}
+
 PaintedRectangleItem *ShadowedRectangle::softwareItem() const
 {
     return m_softwareItem;
@@ -276,6 +301,12 @@ PaintedRectangleItem *ShadowedRectangle::softwareItem() const
 void ShadowedRectangle::itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value)
 {
     if (change == QQuickItem::ItemSceneChange && value.window) {
+        if (m_shaderQuality) {
+            disconnect(m_shaderQuality, nullptr, this, nullptr);
+        }
+        m_shaderQuality = ShaderQuality::forWindow(value.window);
+        connect(m_shaderQuality, &ShaderQuality::lowPowerChanged, this, &ShadowedRectangle::update);
+
         checkSoftwareItem();
         //TODO: only conditionally emit?
         emit softwareRenderingChanged();
@@ -286,28 +317,52 @@ QSGNode *ShadowedRectangle::updatePaintNode(QSGNode *node, QQuickItem::UpdatePai
 {
     Q_UNUSED(data);
 
-    auto shadowNode = static_cast<ShadowedRectangleNode*>(node);
+    const bool lowPower = isLowPower();
 
-    if (!shadowNode) {
-        shadowNode = new ShadowedRectangleNode{};
+    const bool cachedShadow = m_shadow->isCached()
+        && m_shadow->size() > 0.0 && width() > 0.0 && height() > 0.0;
+    if (node && (cachedShadow != m_cachedShadowNode || lowPower != m_lowPowerNode)) {
+        delete node;
+        node = nullptr;
+    }
+    m_cachedShadowNode = cachedShadow;
+    m_lowPowerNode = lowPower;
+
+    // The cached shadow is drawn by the parent of the rectangle, so it is below it
+    auto cachedShadowNode = cachedShadow ? static_cast<CachedShadowNode*>(node) : nullptr;
+    auto shadowNode = cachedShadow ? (node ? static_cast<ShadowedRectangleNode*>(node->firstChild()) : nullptr) : static_cast<ShadowedRectangleNode*>(node);
 
-        // Cache lowPower state so we only execute the full check once.
-        static bool lowPower = QByteArrayList{"1", "true"}.contains(qgetenv("KIRIGAMI_LOWPOWER_HARDWARE").toLower());
+    if (!shadowNode) {
+        shadowNode = BatchedShadowedRectangleNode::create();
         if (lowPower) {
             shadowNode->setShaderType(ShadowedRectangleMaterial::ShaderType::LowPower);
         }
+
+        if (cachedShadow) {
+            cachedShadowNode = new CachedShadowNode{};
+            cachedShadowNode->appendChildNode(shadowNode);
+        }
     }
 
+    const QVector2D offset{float(m_shadow->xOffset()), float(m_shadow->yOffset())};
+    const QVector4D radius = m_corners->toVector4D(m_radius);
+
     shadowNode->setBorderEnabled(m_border->isEnabled());
     shadowNode->setRect(boundingRect());
-    shadowNode->setSize(m_shadow->size());
-    shadowNode->setRadius(m_corners->toVector4D(m_radius));
-    shadowNode->setOffset(QVector2D{float(m_shadow->xOffset()), float(m_shadow->yOffset())});
+    shadowNode->setSize(cachedShadow ? 0.0 : m_shadow->size());
+    shadowNode->setRadius(radius);
+    shadowNode->setOffset(cachedShadow ? QVector2D{} : offset);
     shadowNode->setColor(m_color);
     shadowNode->setShadowColor(m_shadow->color());
     shadowNode->setBorderWidth(m_border->width());
     shadowNode->setBorderColor(m_border->color());
     shadowNode->updateGeometry();
+
+    if (cachedShadowNode) {
+        const bool opaque = m_color.alpha() == 255 && (!m_border->isEnabled() || m_border->color().alpha() == 255);
+        cachedShadowNode->update(window(), boundingRect(), radius, m_shadow->size(), offset, m_shadow->color(), opaque);
+        return cachedShadowNode;
+    }
     return shadowNode;
 }
 
@@ -324,11 +379,14 @@ void ShadowedRectangle::checkSoftwareItem()
         auto updateItem = [this]() {
             auto borderWidth = m_border->width();
             auto rect = boundingRect();
-            m_softwareItem->setSize(rect.size());
             m_softwareItem->setColor(m_color);
             m_softwareItem->setRadius(m_radius);
             m_softwareItem->setBorderWidth(borderWidth);
             m_softwareItem->setBorderColor(m_border->color());
+            m_softwareItem->setShadowSize(m_shadow->size());
+            m_softwareItem->setShadowOffset(QPointF(m_shadow->xOffset(), m_shadow->yOffset()));
+            m_softwareItem->setShadowColor(m_shadow->color());
+            m_softwareItem->setRectangleSize(rect.size());
         };
 
         updateItem();
@@ -338,6 +396,7 @@ void ShadowedRectangle::checkSoftwareItem()
         connect(this, &ShadowedRectangle::colorChanged, m_softwareItem, updateItem);
         connect(this, &ShadowedRectangle::radiusChanged, m_softwareItem, updateItem);
         connect(m_border.get(), &BorderGroup::changed, m_softwareItem, updateItem);
+        connect(m_shadow.get(), &ShadowGroup::changed, m_softwareItem, updateItem);
         setFlag(QQuickItem::ItemHasContents, false);
     }
 }
@@ -7,9 +7,11 @@
 #pragma once
 
 #include <memory>
+#include <QPointer>
 #include <QQuickItem>
 
 class PaintedRectangleItem;
+class ShaderQuality;
 
 /**
  * Grouped property for rectangle border.
@@ -83,6 +85,20 @@ class ShadowGroup : public QObject
      * Full RGBA colors are supported. The default is fully opaque black.
      */
     Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY changed)
+    /**
+     * Whether the shadow is drawn from a texture instead of computed every frame.
+     *
+     * The texture is rendered once and shared by every rectangle with the same
+     * corners and shadow, whatever their size, which is cheaper for many static
+     * identical items such as cards. The rectangle itself is still drawn by a
+     * shader.
+     *
+     * The default is false. Ignored by ShadowedTexture and ShadowedImage.
+     *
+     * @since 5.78
+     * @since org.kde.kirigami 2.15
+     */
+    Q_PROPERTY(bool cached READ isCached WRITE setCached NOTIFY changed)
 
 public:
     explicit ShadowGroup(QObject *parent = nullptr);
@@ -99,6 +115,9 @@ public:
     QColor color() const;
     void setColor(const QColor &newShadowColor);
 
+    bool isCached() const;
+    void setCached(bool newCached);
+
     Q_SIGNAL void changed();
 
 private:
@@ -106,6 +125,7 @@ private:
     qreal m_xOffset = 0.0;
     qreal m_yOffset = 0.0;
     QColor m_color = Qt::black;
+    bool m_cached = false;
 };
 
 /**
@@ -241,6 +261,10 @@ Q_SIGNALS:
     void softwareRenderingChanged();
 
 protected:
+    /**
+     * Whether the window uses the low power shaders, see ShaderQuality.
+     */
+    bool isLowPower() const;
     PaintedRectangleItem *softwareItem() const;
     void itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value) override;
     QSGNode *updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData *data) override;
@@ -253,4 +277,9 @@ private:
     qreal m_radius = 0.0;
     QColor m_color = Qt::white;
     PaintedRectangleItem *m_softwareItem = nullptr;
+    QPointer<ShaderQuality> m_shaderQuality;
+    // Whether the paint node is a CachedShadowNode
+    bool m_cachedShadowNode = false;
+    // Whether the paint node uses the low power shaders
+    bool m_lowPowerNode = false;
 };
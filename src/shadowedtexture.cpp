@@ -10,6 +10,7 @@
 #include <QSGRendererInterface>
 #include <QSGRectangleNode>
 
+#include "scenegraph/batchedshadowedrectanglenode.h"
 #include "scenegraph/shadowedtexturenode.h"
 
 ShadowedTexture::ShadowedTexture(QQuickItem *parentItem)
@@ -50,16 +51,18 @@ QSGNode *ShadowedTexture::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaint
 
     auto shadowNode = static_cast<ShadowedRectangleNode*>(node);
 
-    if (!shadowNode || m_sourceChanged) {
+    const bool lowPower = isLowPower();
+    if (!shadowNode || m_sourceChanged || lowPower != m_lowPowerNode) {
         m_sourceChanged = false;
+        m_lowPowerNode = lowPower;
         delete shadowNode;
         if (m_source) {
             shadowNode = new ShadowedTextureNode{};
         } else {
-            shadowNode = new ShadowedRectangleNode{};
+            shadowNode = BatchedShadowedRectangleNode::create();
         }
 
-        if (qEnvironmentVariableIsSet("KIRIGAMI_LOWPOWER_HARDWARE")) {
+        if (lowPower) {
             shadowNode->setShaderType(ShadowedRectangleMaterial::ShaderType::LowPower);
         }
     }
@@ -38,4 +38,5 @@ protected:
 private:
     QQuickItem *m_source = nullptr;
     bool m_sourceChanged = false;
+    bool m_lowPowerNode = false;
 };
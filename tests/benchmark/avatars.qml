@@ -0,0 +1,23 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+import QtQuick 2.12
+import org.kde.kirigami 2.15 as Kirigami
+
+// benchmarkCount avatars showing initials
+Flow {
+    spacing: 4
+
+    Repeater {
+        model: benchmarkCount
+
+        Kirigami.Avatar {
+            width: 48
+            height: 48
+            name: "Person " + String.fromCharCode(65 + index % 26)
+        }
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+import QtQuick 2.12
+import org.kde.kirigami 2.15 as Kirigami
+
+// benchmarkCount theme icons, of a few sizes
+Flow {
+    spacing: 4
+
+    Repeater {
+        model: benchmarkCount
+
+        Kirigami.Icon {
+            width: [16, 22, 32, 48][index % 4]
+            height: width
+            source: ["document-new", "edit-delete", "go-next", "folder"][Math.floor(index / 4) % 4]
+        }
+    }
+}
@@ -0,0 +1,403 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickRenderControl>
+#include <QQuickWindow>
+#include <QRegularExpression>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+/**
+ * Renders QML scenes offscreen with QQuickRenderControl and reports what
+ * each frame costs:
+ *
+ * @code
+ * kirigamibenchmark --count 500 --frames 200 shadowedrectangles.qml icons.qml
+ * @endcode
+ *
+ * Scenes get the `benchmarkCount` and `benchmarkFrame` context properties,
+ * to create that many items and to change them every frame. Scenes can
+ * also be windows, such as the manual tests next to this directory, whose
+ * content is then moved to the offscreen window.
+ *
+ * OpenGL is used when a context can be created, which on machines without
+ * GPU is the case with Mesa's llvmpipe, otherwise the software backend of
+ * Qt Quick.
+ *
+ * With --compare, every scene is rendered once with batched rectangles and
+ * once with KIRIGAMI_NO_BATCHED_RECTANGLES set, and the two images are
+ * compared, as batching must not change how anything looks.
+ *
+ * With --batches, batches and draw calls are counted from the debug output
+ * of the batch renderer, so only with OpenGL. As the renderer then formats a
+ * message per batch while rendering, render times of such runs are inflated
+ * by the number of batches, and must not be compared with runs without it.
+ */
+
+struct BenchmarkOptions
+{
+    int count = 100;
+    int frames = 100;
+    QSize size = QSize(800, 600);
+    QStringList importPaths;
+    bool batches = false;
+    bool compare = false;
+    bool verbose = false;
+};
+
+// The largest difference of a color channel between batched and unbatched
+// renderings, from the precision of vertex attributes compared to uniforms
+static const int s_compareTolerance = 3;
+
+struct FrameStatistics
+{
+    double sync = 0.0;
+    double render = 0.0;
+    int batches = 0;
+    int drawCalls = 0;
+};
+
+static FrameStatistics s_frame;
+static bool s_rendering = false;
+static QtMessageHandler s_previousHandler = nullptr;
+
+static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    if (!s_rendering || type != QtDebugMsg) {
+        s_previousHandler(type, context, message);
+        return;
+    }
+
+    // While rendering, debug messages come from QSG_RENDERER_DEBUG=render,
+    // with a line per batch such as:
+    // " - Batch(0x...) [retained] [noclip] [ alpha] [  merged]  Nodes:    4  Vertices: ..."
+    static const QRegularExpression batch(QStringLiteral("\\[ *(un)?merged\\]\\s+Nodes:\\s*(\\d+)"));
+    const auto match = batch.match(message);
+    if (match.hasMatch()) {
+        ++s_frame.batches;
+        // Merged batches are drawn at once, unmerged ones node by node
+        s_frame.drawCalls += match.capturedRef(1).isEmpty() ? 1 : match.capturedRef(2).toInt();
+    }
+}
+
+static double milliseconds(QElapsedTimer &timer)
+{
+    const double elapsed = timer.nsecsElapsed() / 1000000.0;
+    timer.restart();
+    return elapsed;
+}
+
+// Creates the scene at path in window, returns its root object or null
+static std::unique_ptr<QObject> loadScene(const QString &path, const BenchmarkOptions &options, QQmlEngine &engine, QQuickWindow &window)
+{
+    window.setGeometry(QRect(QPoint(), options.size));
+    window.contentItem()->setSize(options.size);
+
+    for (const QString &importPath : options.importPaths) {
+        engine.addImportPath(importPath);
+    }
+    engine.rootContext()->setContextProperty(QStringLiteral("benchmarkCount"), options.count);
+    engine.rootContext()->setContextProperty(QStringLiteral("benchmarkFrame"), 0);
+
+    QQmlComponent component(&engine, QUrl::fromLocalFile(path));
+    std::unique_ptr<QObject> root(component.create());
+    if (!root) {
+        for (const auto &error : component.errors()) {
+            qWarning().noquote() << error.toString();
+        }
+        return nullptr;
+    }
+
+    if (auto item = qobject_cast<QQuickItem *>(root.get())) {
+        item->setParentItem(window.contentItem());
+        if (item->width() <= 0.0 || item->height() <= 0.0) {
+            item->setSize(options.size);
+        }
+    } else if (auto sourceWindow = qobject_cast<QQuickWindow *>(root.get())) {
+        sourceWindow->setVisible(false);
+        sourceWindow->resize(options.size);
+        const auto children = sourceWindow->contentItem()->childItems();
+        for (auto child : children) {
+            child->setParentItem(window.contentItem());
+        }
+    } else {
+        qWarning() << path << "is neither an item nor a window";
+        return nullptr;
+    }
+    return root;
+}
+
+static bool runScene(const QString &path, const BenchmarkOptions &options, QOpenGLContext *context, QOffscreenSurface *surface, QTextStream &out)
+{
+    QQuickRenderControl control;
+    QQuickWindow window(&control);
+    QQmlEngine engine;
+    const std::unique_ptr<QObject> root = loadScene(path, options, engine, window);
+    if (!root) {
+        return false;
+    }
+
+    std::unique_ptr<QOpenGLFramebufferObject> framebuffer;
+    if (context) {
+        context->makeCurrent(surface);
+        control.initialize(context);
+        framebuffer.reset(new QOpenGLFramebufferObject(options.size, QOpenGLFramebufferObject::CombinedDepthStencil));
+        window.setRenderTarget(framebuffer.get());
+    } else {
+        control.initialize(nullptr);
+    }
+
+    FrameStatistics first;
+    FrameStatistics total;
+    FrameStatistics worst;
+
+    QElapsedTimer timer;
+    for (int frame = 0; frame <= options.frames; ++frame) {
+        engine.rootContext()->setContextProperty(QStringLiteral("benchmarkFrame"), frame);
+        QCoreApplication::processEvents();
+
+        if (context) {
+            context->makeCurrent(surface);
+        }
+
+        s_frame = FrameStatistics{};
+        timer.start();
+        control.polishItems();
+        control.sync();
+        s_frame.sync = milliseconds(timer);
+
+        s_rendering = true;
+        if (context) {
+            control.render();
+            // Include the time the GPU takes, not only the submission
+            context->functions()->glFinish();
+        } else {
+            // Software rendering only happens into an image
+            control.grab();
+        }
+        s_frame.render = milliseconds(timer);
+        s_rendering = false;
+
+        if (options.verbose) {
+            out << QStringLiteral("  frame %1: sync %2 ms, render %3 ms").arg(frame).arg(s_frame.sync, 0, 'f', 2).arg(s_frame.render, 0, 'f', 2);
+            if (context && options.batches) {
+                out << QStringLiteral(", %1 batches, %2 draw calls").arg(s_frame.batches).arg(s_frame.drawCalls);
+            }
+            out << '\n';
+        }
+
+        // The first frame creates nodes and compiles shaders, so is reported apart
+        if (frame == 0) {
+            first = s_frame;
+            continue;
+        }
+
+        total.sync += s_frame.sync;
+        total.render += s_frame.render;
+        total.batches += s_frame.batches;
+        total.drawCalls += s_frame.drawCalls;
+        worst.sync = std::max(worst.sync, s_frame.sync);
+        worst.render = std::max(worst.render, s_frame.render);
+    }
+
+    const int frames = std::max(1, options.frames);
+    out << QStringLiteral("%1: %2 items, %3 frames of %4x%5")
+               .arg(path).arg(options.count).arg(options.frames).arg(options.size.width()).arg(options.size.height())
+        << '\n';
+    out << QStringLiteral("  first frame: sync %1 ms, render %2 ms").arg(first.sync, 0, 'f', 2).arg(first.render, 0, 'f', 2) << '\n';
+    out << QStringLiteral("  per frame:   sync %1 ms (max %2), render %3 ms (max %4)")
+               .arg(total.sync / frames, 0, 'f', 2).arg(worst.sync, 0, 'f', 2).arg(total.render / frames, 0, 'f', 2).arg(worst.render, 0, 'f', 2)
+        << '\n';
+    if (context && options.batches) {
+        out << QStringLiteral("               %1 batches, %2 draw calls")
+                   .arg(double(total.batches) / frames, 0, 'f', 1).arg(double(total.drawCalls) / frames, 0, 'f', 1)
+            << '\n';
+    }
+
+    out.flush();
+
+    if (context) {
+        context->makeCurrent(surface);
+    }
+    control.invalidate();
+    return true;
+}
+
+// Renders the first frame of the scene at path
+static QImage grabScene(const QString &path, const BenchmarkOptions &options, QOpenGLContext *context, QOffscreenSurface *surface)
+{
+    QQuickRenderControl control;
+    QQuickWindow window(&control);
+    QQmlEngine engine;
+    const std::unique_ptr<QObject> root = loadScene(path, options, engine, window);
+    if (!root) {
+        return QImage();
+    }
+
+    std::unique_ptr<QOpenGLFramebufferObject> framebuffer;
+    if (context) {
+        context->makeCurrent(surface);
+        control.initialize(context);
+        framebuffer.reset(new QOpenGLFramebufferObject(options.size, QOpenGLFramebufferObject::CombinedDepthStencil));
+        window.setRenderTarget(framebuffer.get());
+    } else {
+        control.initialize(nullptr);
+    }
+
+    QCoreApplication::processEvents();
+    control.polishItems();
+    control.sync();
+    const QImage image = control.grab().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    if (context) {
+        context->makeCurrent(surface);
+    }
+    control.invalidate();
+    return image;
+}
+
+static bool compareScene(const QString &path, const BenchmarkOptions &options, QOpenGLContext *context, QOffscreenSurface *surface, QTextStream &out)
+{
+    qunsetenv("KIRIGAMI_NO_BATCHED_RECTANGLES");
+    const QImage batched = grabScene(path, options, context, surface);
+    qputenv("KIRIGAMI_NO_BATCHED_RECTANGLES", "1");
+    const QImage unbatched = grabScene(path, options, context, surface);
+    qunsetenv("KIRIGAMI_NO_BATCHED_RECTANGLES");
+
+    if (batched.isNull() || batched.size() != unbatched.size()) {
+        out << QStringLiteral("%1: could not render").arg(path) << '\n';
+        return false;
+    }
+
+    int maximum = 0;
+    int differing = 0;
+    for (int y = 0; y < batched.height(); ++y) {
+        auto first = reinterpret_cast<const QRgb *>(batched.constScanLine(y));
+        auto second = reinterpret_cast<const QRgb *>(unbatched.constScanLine(y));
+        for (int x = 0; x < batched.width(); ++x) {
+            const int difference = std::max({std::abs(qRed(first[x]) - qRed(second[x])),
+                                             std::abs(qGreen(first[x]) - qGreen(second[x])),
+                                             std::abs(qBlue(first[x]) - qBlue(second[x])),
+                                             std::abs(qAlpha(first[x]) - qAlpha(second[x]))});
+            maximum = std::max(maximum, difference);
+            if (difference > s_compareTolerance) {
+                ++differing;
+            }
+        }
+    }
+
+    out << QStringLiteral("%1: batched and unbatched renderings differ by up to %2, %3 pixels by more than %4")
+               .arg(path).arg(maximum).arg(differing).arg(s_compareTolerance)
+        << '\n';
+    out.flush();
+    return differing == 0;
+}
+
+int main(int argc, char **argv)
+{
+    QGuiApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("kirigamibenchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the cost of rendering QML scenes offscreen"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("scenes"), QStringLiteral("The QML files of the scenes to render"), QStringLiteral("scene.qml..."));
+
+    QCommandLineOption countOption(QStringLiteral("count"), QStringLiteral("The number of items the scenes create, as benchmarkCount"), QStringLiteral("count"), QStringLiteral("100"));
+    QCommandLineOption framesOption(QStringLiteral("frames"), QStringLiteral("The number of frames to render after the first one"), QStringLiteral("frames"), QStringLiteral("100"));
+    QCommandLineOption sizeOption(QStringLiteral("size"), QStringLiteral("The size of the window"), QStringLiteral("width x height"), QStringLiteral("800x600"));
+    QCommandLineOption importOption(QStringLiteral("import"), QStringLiteral("An additional QML import path"), QStringLiteral("path"));
+    QCommandLineOption softwareOption(QStringLiteral("software"), QStringLiteral("Use the software backend even if OpenGL is available"));
+    QCommandLineOption batchesOption(QStringLiteral("batches"), QStringLiteral("Count batches and draw calls, which slows rendering down"));
+    QCommandLineOption compareOption(QStringLiteral("compare"), QStringLiteral("Compare the first frame with and without batched rectangles, instead of measuring"));
+    QCommandLineOption verboseOption(QStringLiteral("verbose"), QStringLiteral("Report every frame"));
+    parser.addOptions({countOption, framesOption, sizeOption, importOption, softwareOption, batchesOption, compareOption, verboseOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    BenchmarkOptions options;
+    options.count = parser.value(countOption).toInt();
+    options.frames = parser.value(framesOption).toInt();
+    const QStringList size = parser.value(sizeOption).split(QLatin1Char('x'));
+    if (size.count() == 2) {
+        options.size = QSize(size[0].toInt(), size[1].toInt());
+    }
+    options.importPaths = parser.values(importOption);
+#ifdef KIRIGAMI_BUILD_IMPORT_PATH
+    options.importPaths << QStringLiteral(KIRIGAMI_BUILD_IMPORT_PATH);
+#endif
+    options.batches = parser.isSet(batchesOption);
+    options.compare = parser.isSet(compareOption);
+    options.verbose = parser.isSet(verboseOption);
+
+    // The batch renderer only reports its batches with this set, which it reads
+    // once when first used. Otherwise it must not be set, as the reports would
+    // be included in the render times.
+    if (options.batches) {
+        qputenv("QSG_RENDERER_DEBUG", "render");
+    } else if (qEnvironmentVariable("QSG_RENDERER_DEBUG").contains(QLatin1String("render"))) {
+        qWarning() << "QSG_RENDERER_DEBUG is set, render times include its output";
+    }
+
+    std::unique_ptr<QOpenGLContext> context;
+    std::unique_ptr<QOffscreenSurface> surface;
+    if (!parser.isSet(softwareOption)) {
+        context.reset(new QOpenGLContext);
+        surface.reset(new QOffscreenSurface);
+        if (context->create()) {
+            surface->setFormat(context->format());
+            surface->create();
+        }
+        if (!context->isValid() || !surface->isValid() || !context->makeCurrent(surface.get())) {
+            qWarning() << "Could not create an OpenGL context, using the software backend";
+            context.reset();
+            surface.reset();
+        }
+    }
+
+    QTextStream out(stdout);
+    if (context) {
+        out << "OpenGL renderer: " << reinterpret_cast<const char *>(context->functions()->glGetString(GL_RENDERER)) << '\n';
+        if (options.batches) {
+            out << "Counting batches, render times are not comparable with runs without --batches" << '\n';
+        }
+    } else {
+        QQuickWindow::setSceneGraphBackend(QSGRendererInterface::Software);
+        out << "Software renderer" << '\n';
+    }
+
+    if (options.batches) {
+        s_previousHandler = qInstallMessageHandler(messageHandler);
+    }
+
+    int result = 0;
+    const auto scenes = parser.positionalArguments();
+    for (const QString &scene : scenes) {
+        const bool success = options.compare ? compareScene(scene, options, context.get(), surface.get(), out)
+                                             : runScene(scene, options, context.get(), surface.get(), out);
+        if (!success) {
+            result = 1;
+        }
+    }
+    return result;
+}
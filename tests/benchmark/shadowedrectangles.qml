@@ -0,0 +1,32 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+import QtQuick 2.12
+import org.kde.kirigami 2.15 as Kirigami
+
+// benchmarkCount rectangles with shadows, half of them with a border,
+// changing color every frame
+Flow {
+    spacing: 10
+
+    Repeater {
+        model: benchmarkCount
+
+        Kirigami.ShadowedRectangle {
+            width: 60
+            height: 40
+            radius: 5
+            color: Qt.hsla(((index + benchmarkFrame) % 36) / 36, 0.5, 0.5, 1)
+
+            shadow.size: 8
+            shadow.yOffset: 2
+            shadow.color: Qt.rgba(0, 0, 0, 0.3)
+
+            border.width: index % 2
+            border.color: "black"
+        }
+    }
+}
@@ -0,0 +1,27 @@
+/*
+ *  SPDX-FileCopyrightText: 2020 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+import QtQuick 2.12
+import org.kde.kirigami 2.15 as Kirigami
+
+// benchmarkCount images with rounded corners and shadows
+Flow {
+    spacing: 10
+
+    Repeater {
+        model: benchmarkCount
+
+        Kirigami.ShadowedImage {
+            width: 48
+            height: 48
+            radius: 24 - (index + benchmarkFrame) % 12
+            source: Qt.resolvedUrl("../../logo.png")
+
+            shadow.size: 8
+            shadow.color: Qt.rgba(0, 0, 0, 0.3)
+        }
+    }
+}